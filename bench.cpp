@@ -0,0 +1,622 @@
+#include "splay_tree.hpp"
+#include "compact_splay_tree.hpp"
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <array>
+#include <random>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <algorithm>
+#include <optional>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Self-contained throughput harness. Every (container, operation, workload, size) combination is timed once and
+// reported as a JSON array together with per-operation hardware counters where the kernel allows perf_event_open, e.g.
+//   splay_tree_bench --sizes=1000,1000000,100000000 --operations=10000000 --filter=find --output=results.json
+namespace
+{
+  using key_type = std::uint64_t;
+
+  struct options
+  {
+    std::vector<std::size_t> sizes{ 1000, 100000, 1000000 };
+    std::size_t operations = 0;
+    std::string filter;
+    std::string output;
+    std::uint64_t seed = 42;
+  };
+
+  constexpr std::array counter_names{ "instructions", "cycles", "branch_misses", "l1d_misses", "llc_misses" };
+
+  using counter_values = std::array<std::optional<double>, counter_names.size()>;
+
+  struct measurement
+  {
+    double nanoseconds;
+    counter_values counters;
+  };
+
+  struct result
+  {
+    std::string container;
+    std::string operation;
+    std::string workload;
+    std::size_t size;
+    std::size_t operations;
+    double nanoseconds_per_operation;
+    counter_values counters_per_operation;
+  };
+
+  // One perf_event_open descriptor per counter, counting user space of the calling thread only. Counters the kernel or
+  // the PMU refuses (no permission, virtual machine, non-Linux build) stay closed and are reported as null. Values are
+  // scaled by enabled / running time in case the kernel multiplexed them.
+  class hardware_counters
+  {
+#if defined(__linux__)
+    std::array<int, counter_names.size()> descriptors_;
+
+    static int open_counter(std::uint32_t type, std::uint64_t config) noexcept
+    {
+      perf_event_attr attributes{};
+      attributes.size = sizeof(attributes);
+      attributes.type = type;
+      attributes.config = config;
+      attributes.disabled = 1;
+      attributes.exclude_kernel = 1;
+      attributes.exclude_hv = 1;
+      attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+      return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+    }
+
+    static constexpr std::uint64_t cache_miss(std::uint64_t cache) noexcept
+    {
+      return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+
+  public:
+    hardware_counters() noexcept
+      : descriptors_{ open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS), open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES),
+        open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES), open_counter(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D)),
+        open_counter(PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL)) }
+    {}
+
+    hardware_counters(const hardware_counters&) = delete;
+    hardware_counters& operator=(const hardware_counters&) = delete;
+
+    ~hardware_counters() noexcept
+    {
+      for (int descriptor : descriptors_)
+      {
+        if (descriptor >= 0)
+        {
+          close(descriptor);
+        }
+      }
+    }
+
+    bool any_available() const noexcept
+    {
+      return std::ranges::any_of(descriptors_, [](int descriptor) { return descriptor >= 0; });
+    }
+
+    void start() noexcept
+    {
+      for (int descriptor : descriptors_)
+      {
+        if (descriptor >= 0)
+        {
+          ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+          ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+        }
+      }
+    }
+
+    counter_values stop() noexcept
+    {
+      counter_values result;
+
+      for (std::size_t j = 0; j < descriptors_.size(); j++)
+      {
+        std::uint64_t values[3] = {};
+
+        if (descriptors_[j] < 0)
+        {
+          continue;
+        }
+
+        ioctl(descriptors_[j], PERF_EVENT_IOC_DISABLE, 0);
+
+        if (read(descriptors_[j], values, sizeof(values)) == static_cast<ssize_t>(sizeof(values)) && values[2] != 0)
+        {
+          result[j] = static_cast<double>(values[0]) * static_cast<double>(values[1]) / static_cast<double>(values[2]);
+        }
+      }
+
+      return result;
+    }
+#else
+  public:
+    bool any_available() const noexcept
+    {
+      return false;
+    }
+
+    void start() noexcept
+    {}
+
+    counter_values stop() noexcept
+    {
+      return {};
+    }
+#endif
+  };
+
+  enum class workload
+  {
+    uniform,
+    zipfian,
+    sequential,
+    working_set_shift,
+    sliding_window
+  };
+
+  constexpr std::array all_workloads{ workload::uniform, workload::zipfian, workload::sequential, workload::working_set_shift, workload::sliding_window };
+
+  std::string_view workload_name(workload kind) noexcept
+  {
+    switch (kind)
+    {
+    case workload::uniform:
+      return "uniform";
+    case workload::zipfian:
+      return "zipfian";
+    case workload::sequential:
+      return "sequential";
+    case workload::working_set_shift:
+      return "working_set_shift";
+    case workload::sliding_window:
+      return "sliding_window";
+    }
+
+    return "unknown";
+  }
+
+  volatile key_type sink;
+
+  // Scrambles ranks so that the hottest keys of the Zipfian stream are spread over the key space.
+  key_type scramble(key_type rank, std::size_t size) noexcept
+  {
+    return (rank * 0x9E3779B97F4A7C15ull >> 11) % size;
+  }
+
+  // Gray et al., "Quickly generating billion-record synthetic databases" (the generator YCSB uses), with theta = 0.99.
+  class zipfian_generator
+  {
+    static constexpr double theta = 0.99;
+
+    std::size_t size_;
+    double zeta_n_;
+    double alpha_;
+    double eta_;
+    double half_pow_theta_;
+
+    static double zeta(std::size_t count) noexcept
+    {
+      double result = 0.;
+
+      for (std::size_t j = 1; j <= count; j++)
+      {
+        result += 1. / std::pow(static_cast<double>(j), theta);
+      }
+
+      return result;
+    }
+
+  public:
+    explicit zipfian_generator(std::size_t size)
+      : size_{ size }, zeta_n_{ zeta(size) }, alpha_{ 1. / (1. - theta) },
+      eta_{ (1. - std::pow(2. / static_cast<double>(size), 1. - theta)) / (1. - zeta(2) / zeta_n_) },
+      half_pow_theta_{ 1. + std::pow(0.5, theta) }
+    {}
+
+    template<class Engine>
+    key_type operator()(Engine& engine) const
+    {
+      double u = std::uniform_real_distribution<double>{ 0., 1. }(engine);
+      double uz = u * zeta_n_;
+
+      if (uz < 1.)
+      {
+        return 0;
+      }
+
+      if (uz < half_pow_theta_)
+      {
+        return 1;
+      }
+
+      return std::min<key_type>(size_ - 1, static_cast<key_type>(static_cast<double>(size_) * std::pow(eta_ * u - eta_ + 1., alpha_)));
+    }
+  };
+
+  // Keys are drawn from [0, size). The working set shift draws uniformly from a window of 1% of the keys that jumps to
+  // a random place ten times per stream; the sliding window moves the same window forward by one key per operation.
+  std::vector<key_type> make_stream(workload kind, std::size_t size, std::size_t count, std::uint64_t seed)
+  {
+    std::mt19937_64 engine{ seed };
+    std::vector<key_type> result(count);
+    std::size_t window = std::max<std::size_t>(size / 100, 1);
+
+    switch (kind)
+    {
+    case workload::uniform:
+    {
+      std::uniform_int_distribution<key_type> distribution{ 0, size - 1 };
+      std::ranges::generate(result, [&] { return distribution(engine); });
+      break;
+    }
+    case workload::zipfian:
+    {
+      zipfian_generator generator{ size };
+      std::ranges::generate(result, [&] { return scramble(generator(engine), size); });
+      break;
+    }
+    case workload::sequential:
+      for (std::size_t j = 0; j < count; j++)
+      {
+        result[j] = j % size;
+      }
+      break;
+    case workload::working_set_shift:
+    {
+      std::uniform_int_distribution<key_type> offsets{ 0, size - 1 };
+      std::uniform_int_distribution<key_type> distribution{ 0, window - 1 };
+      std::size_t phase = std::max<std::size_t>(count / 10, 1);
+      key_type offset = 0;
+
+      for (std::size_t j = 0; j < count; j++)
+      {
+        if (j % phase == 0)
+        {
+          offset = offsets(engine);
+        }
+
+        result[j] = (offset + distribution(engine)) % size;
+      }
+      break;
+    }
+    case workload::sliding_window:
+    {
+      std::uniform_int_distribution<key_type> distribution{ 0, window - 1 };
+
+      for (std::size_t j = 0; j < count; j++)
+      {
+        result[j] = (j + distribution(engine)) % size;
+      }
+      break;
+    }
+    }
+
+    return result;
+  }
+
+  template<class Function>
+  measurement measure(hardware_counters& counters, Function&& function)
+  {
+    counters.start();
+    auto start = std::chrono::steady_clock::now();
+    function();
+    auto finish = std::chrono::steady_clock::now();
+    counter_values values = counters.stop();
+
+    return { std::chrono::duration<double, std::nano>(finish - start).count(), values };
+  }
+
+  template<class Map>
+  Map make_filled(std::size_t size, std::uint64_t seed)
+  {
+    std::vector<key_type> keys(size);
+    std::iota(keys.begin(), keys.end(), key_type{ 0 });
+    std::ranges::shuffle(keys, std::mt19937_64{ seed });
+
+    Map map;
+
+    for (key_type key : keys)
+    {
+      map.emplace(key, key);
+    }
+
+    return map;
+  }
+
+  class runner
+  {
+    const options& options_;
+    hardware_counters counters_;
+    std::vector<result> results_;
+
+    bool selected(std::string_view container, std::string_view operation) const
+    {
+      if (options_.filter.empty())
+      {
+        return true;
+      }
+
+      std::string name = std::string{ container } + "/" + std::string{ operation };
+
+      return name.find(options_.filter) != std::string::npos;
+    }
+
+    void record(std::string_view container, std::string_view operation, std::string_view workload, std::size_t size,
+      std::size_t operations, const measurement& elapsed)
+    {
+      double divisor = static_cast<double>(std::max<std::size_t>(operations, 1));
+      counter_values per_operation;
+
+      for (std::size_t j = 0; j < per_operation.size(); j++)
+      {
+        if (elapsed.counters[j])
+        {
+          per_operation[j] = *elapsed.counters[j] / divisor;
+        }
+      }
+
+      results_.push_back({ std::string{ container }, std::string{ operation }, std::string{ workload }, size, operations,
+        elapsed.nanoseconds / divisor, per_operation });
+      std::fprintf(stderr, "%-24s %-14s %-18s %12zu %10.1f ns/op", std::string{ container }.c_str(), std::string{ operation }.c_str(),
+        std::string{ workload }.c_str(), size, results_.back().nanoseconds_per_operation);
+
+      for (std::size_t j = 0; j < per_operation.size(); j++)
+      {
+        if (per_operation[j])
+        {
+          std::fprintf(stderr, " %10.2f %s", *per_operation[j], counter_names[j]);
+        }
+      }
+
+      std::fprintf(stderr, "\n");
+    }
+
+  public:
+    explicit runner(const options& options) : options_{ options }
+    {
+      if (!counters_.any_available())
+      {
+        std::fprintf(stderr, "hardware counters are unavailable, reporting wall-clock time only\n");
+      }
+    }
+
+    template<class Map>
+    void run_container(std::string_view container)
+    {
+      for (std::size_t size : options_.sizes)
+      {
+        std::size_t operations = options_.operations != 0 ? options_.operations : std::clamp<std::size_t>(size, 100000, 10000000);
+
+        for (workload kind : all_workloads)
+        {
+          std::vector<key_type> stream = make_stream(kind, size, operations, options_.seed);
+
+          if (selected(container, "find"))
+          {
+            Map map = make_filled<Map>(size, options_.seed);
+            measurement elapsed = measure(counters_, [&]
+            {
+              key_type sum = 0;
+
+              for (key_type key : stream)
+              {
+                auto it = map.find(key);
+                sum += it != map.end() ? it->second : 0;
+              }
+
+              sink = sum;
+            });
+            record(container, "find", workload_name(kind), size, operations, elapsed);
+          }
+
+          if (selected(container, "emplace"))
+          {
+            Map map;
+            measurement elapsed = measure(counters_, [&]
+            {
+              for (key_type key : stream)
+              {
+                map.emplace(key, key);
+              }
+            });
+            record(container, "emplace", workload_name(kind), size, operations, elapsed);
+          }
+
+          if (selected(container, "erase"))
+          {
+            Map map = make_filled<Map>(size, options_.seed);
+            measurement elapsed = measure(counters_, [&]
+            {
+              for (key_type key : stream)
+              {
+                map.erase(key);
+              }
+            });
+            record(container, "erase", workload_name(kind), size, operations, elapsed);
+          }
+        }
+
+        if (selected(container, "iterate"))
+        {
+          Map map = make_filled<Map>(size, options_.seed);
+          std::size_t passes = std::max<std::size_t>(operations / size, 1);
+          measurement elapsed = measure(counters_, [&]
+          {
+            key_type sum = 0;
+
+            for (std::size_t pass = 0; pass < passes; pass++)
+            {
+              for (const auto& [key, value] : map)
+              {
+                sum += value;
+              }
+            }
+
+            sink = sum;
+          });
+          record(container, "iterate", "sequential", size, passes * size, elapsed);
+        }
+
+        if constexpr (requires(Map& map) { map.merge(map); })
+        {
+          if (selected(container, "merge"))
+          {
+            for (bool interleaved : { true, false })
+            {
+              // Sharing the allocator (and with it a slab_allocator pool) lets the splay trees relink nodes.
+              Map target;
+              Map source{ target.get_allocator() };
+
+              for (key_type key = 0; key < size; key++)
+              {
+                bool to_source = interleaved ? key % 2 == 1 : key >= size / 2;
+                (to_source ? source : target).emplace(key, key);
+              }
+
+              measurement elapsed = measure(counters_, [&] { target.merge(source); });
+              record(container, "merge", interleaved ? "interleaved" : "disjoint", size, size, elapsed);
+            }
+          }
+        }
+      }
+    }
+
+    void write_json(std::ostream& stream) const
+    {
+      stream << "[\n";
+
+      for (std::size_t j = 0; j < results_.size(); j++)
+      {
+        const result& entry = results_[j];
+        stream << "  { \"container\": \"" << entry.container << "\", \"operation\": \"" << entry.operation
+          << "\", \"workload\": \"" << entry.workload << "\", \"size\": " << entry.size << ", \"operations\": " << entry.operations
+          << ", \"ns_per_op\": " << entry.nanoseconds_per_operation;
+
+        for (std::size_t k = 0; k < counter_names.size(); k++)
+        {
+          stream << ", \"" << counter_names[k] << "_per_op\": ";
+
+          if (entry.counters_per_operation[k])
+          {
+            stream << *entry.counters_per_operation[k];
+          }
+          else
+          {
+            stream << "null";
+          }
+        }
+
+        stream << " }" << (j + 1 == results_.size() ? "\n" : ",\n");
+      }
+
+      stream << "]\n";
+    }
+  };
+
+  std::vector<std::size_t> parse_sizes(std::string_view text)
+  {
+    std::vector<std::size_t> result;
+
+    while (!text.empty())
+    {
+      std::size_t separator = text.find(',');
+      std::string_view token = text.substr(0, separator);
+      double value = 0.;
+      std::from_chars(token.data(), token.data() + token.size(), value);
+
+      if (value >= 1.)
+      {
+        result.push_back(static_cast<std::size_t>(value));
+      }
+
+      text = separator == std::string_view::npos ? std::string_view{} : text.substr(separator + 1);
+    }
+
+    return result;
+  }
+
+  options parse_options(int argc, char** argv)
+  {
+    options result;
+
+    for (int j = 1; j < argc; j++)
+    {
+      std::string_view argument = argv[j];
+      std::string_view value = argument.substr(std::min(argument.find('=') + 1, argument.size()));
+
+      if (argument.starts_with("--sizes="))
+      {
+        result.sizes = parse_sizes(value);
+      }
+      else if (argument.starts_with("--operations="))
+      {
+        result.operations = parse_sizes(value).empty() ? 0 : parse_sizes(value).front();
+      }
+      else if (argument.starts_with("--filter="))
+      {
+        result.filter = value;
+      }
+      else if (argument.starts_with("--output="))
+      {
+        result.output = value;
+      }
+      else if (argument.starts_with("--seed="))
+      {
+        std::from_chars(value.data(), value.data() + value.size(), result.seed);
+      }
+      else
+      {
+        std::fprintf(stderr, "usage: %s [--sizes=1e3,1e6] [--operations=N] [--filter=container/operation] [--output=file.json] [--seed=N]\n", argv[0]);
+        std::exit(1);
+      }
+    }
+
+    return result;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  options settings = parse_options(argc, argv);
+  runner bench{ settings };
+
+  bench.run_container<splay_tree<key_type, key_type>>("splay_tree");
+  bench.run_container<splay_tree<key_type, key_type, std::less<key_type>, std::allocator<std::pair<const key_type, key_type>>,
+    splay_policy::bottom_up>>("splay_tree_bottom_up");
+  bench.run_container<splay_tree<key_type, key_type, std::less<key_type>, slab_allocator<std::pair<const key_type, key_type>>>>("splay_tree_slab");
+  bench.run_container<compact_splay_tree<key_type, key_type>>("compact_splay_tree");
+  bench.run_container<std::map<key_type, key_type>>("std::map");
+  bench.run_container<std::unordered_map<key_type, key_type>>("std::unordered_map");
+
+  if (settings.output.empty())
+  {
+    bench.write_json(std::cout);
+  }
+  else
+  {
+    std::ofstream file{ settings.output };
+    bench.write_json(file);
+  }
+}
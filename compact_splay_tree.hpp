@@ -0,0 +1,1112 @@
+#pragma once
+#include "splay_tree.hpp"
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <iterator>
+#include <utility>
+#include <tuple>
+#include <stdexcept>
+
+// A splay tree whose nodes live in one contiguous arena and link to each other through 32-bit indices, so a node of
+// splay_tree<int, int> shrinks from 32 to 20 bytes and the whole structure can be relocated by moving one buffer.
+// Erased slots are kept on a free list and reused, so an element keeps its index until it is erased. Iterators hold
+// the address of the arena's header and an index: they survive insertions and erasures of other elements, and since
+// move and swap hand the header over to the other tree, they follow their elements there like std::map iterators.
+// Unlike with splay_tree, an insertion that grows the arena relocates every element, so it invalidates all references
+// and pointers into the tree (reserve() avoids that). Lookups splay bottom-up along the parent links.
+template<class Key, class Data, class Comparator = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, Data>>>
+class compact_splay_tree
+{
+public:
+  using key_type = Key;
+  using mapped_type = Data;
+  using value_type = std::pair<const Key, Data>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using key_compare = Comparator;
+  using allocator_type = Allocator;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using index_type = std::uint32_t;
+
+private:
+  static constexpr index_type nil = std::numeric_limits<index_type>::max();
+  // Marks the parent_ of a slot on the free list; such a slot reuses left_ as the link to the next free slot.
+  static constexpr index_type free_mark = nil - 1;
+  static constexpr std::size_t max_capacity = free_mark;
+
+  struct node
+  {
+    index_type parent_ = nil;
+    index_type left_ = nil;
+    index_type right_ = nil;
+
+    union
+    {
+      value_type pair_;
+    };
+
+    node() noexcept
+    {}
+
+    ~node() noexcept
+    {}
+  };
+
+  // The node buffer and its bookkeeping. It is allocated once per tree and changes hands on move and swap, so it is
+  // what iterators point to. Everything here works on indices alone and needs neither the comparator nor the
+  // allocator.
+  struct arena
+  {
+    node* nodes_ = {};
+    index_type capacity_ = {};
+    index_type used_ = {};
+    index_type free_head_ = nil;
+    index_type root_ = nil;
+    std::size_t tree_size_ = {};
+
+    bool is_live(index_type index) const noexcept
+    {
+      return nodes_[index].parent_ != free_mark;
+    }
+
+    index_type sub_tree_min(index_type index) const noexcept
+    {
+      if (index != nil)
+      {
+        while (nodes_[index].left_ != nil)
+        {
+          index = nodes_[index].left_;
+        }
+      }
+
+      return index;
+    }
+
+    index_type sub_tree_max(index_type index) const noexcept
+    {
+      if (index != nil)
+      {
+        while (nodes_[index].right_ != nil)
+        {
+          index = nodes_[index].right_;
+        }
+      }
+
+      return index;
+    }
+
+    index_type successor(index_type index) const noexcept
+    {
+      if (nodes_[index].right_ != nil)
+      {
+        return sub_tree_min(nodes_[index].right_);
+      }
+
+      index_type parent;
+
+      while ((parent = nodes_[index].parent_) != nil && index == nodes_[parent].right_)
+      {
+        index = parent;
+      }
+
+      return parent;
+    }
+
+    index_type predecessor(index_type index) const noexcept
+    {
+      if (nodes_[index].left_ != nil)
+      {
+        return sub_tree_max(nodes_[index].left_);
+      }
+
+      index_type parent;
+
+      while ((parent = nodes_[index].parent_) != nil && index == nodes_[parent].left_)
+      {
+        index = parent;
+      }
+
+      return parent;
+    }
+
+    void destroy_node(index_type index) noexcept
+    {
+      std::destroy_at(std::addressof(nodes_[index].pair_));
+      nodes_[index].parent_ = free_mark;
+      nodes_[index].left_ = free_head_;
+      free_head_ = index;
+    }
+
+    // Destroys every slot below used_ and empties the tree, keeping the buffer.
+    void destroy_slots() noexcept
+    {
+      for (index_type j = 0; j < used_; j++)
+      {
+        if (is_live(j))
+        {
+          std::destroy_at(std::addressof(nodes_[j].pair_));
+        }
+
+        std::destroy_at(nodes_ + j);
+      }
+
+      used_ = 0;
+      free_head_ = nil;
+      root_ = nil;
+      tree_size_ = 0;
+    }
+
+    void rotate_up(index_type target) noexcept
+    {
+      node& target_node = nodes_[target];
+      index_type parent = target_node.parent_;
+      node& parent_node = nodes_[parent];
+      index_type grandparent = parent_node.parent_;
+
+      if (parent_node.left_ == target)
+      {
+        parent_node.left_ = target_node.right_;
+
+        if (target_node.right_ != nil)
+        {
+          nodes_[target_node.right_].parent_ = parent;
+        }
+
+        target_node.right_ = parent;
+      }
+      else
+      {
+        parent_node.right_ = target_node.left_;
+
+        if (target_node.left_ != nil)
+        {
+          nodes_[target_node.left_].parent_ = parent;
+        }
+
+        target_node.left_ = parent;
+      }
+
+      parent_node.parent_ = target;
+      target_node.parent_ = grandparent;
+
+      if (grandparent == nil)
+      {
+        root_ = target;
+      }
+      else if (nodes_[grandparent].left_ == parent)
+      {
+        nodes_[grandparent].left_ = target;
+      }
+      else
+      {
+        nodes_[grandparent].right_ = target;
+      }
+    }
+
+    void splay(index_type target) noexcept
+    {
+      while (nodes_[target].parent_ != nil)
+      {
+        index_type parent = nodes_[target].parent_;
+        index_type grandparent = nodes_[parent].parent_;
+
+        if (grandparent != nil)
+        {
+          bool zig_zig = (nodes_[grandparent].left_ == parent) == (nodes_[parent].left_ == target);
+          rotate_up(zig_zig ? parent : target);
+        }
+
+        rotate_up(target);
+      }
+    }
+
+    void remove_root() noexcept
+    {
+      index_type old_root = root_;
+      index_type left_sub_tree = nodes_[old_root].left_;
+      index_type right_sub_tree = nodes_[old_root].right_;
+
+      if (left_sub_tree == nil)
+      {
+        root_ = right_sub_tree;
+      }
+      else
+      {
+        nodes_[left_sub_tree].parent_ = nil;
+        root_ = left_sub_tree;
+        index_type max_node = sub_tree_max(left_sub_tree);
+        splay(max_node);
+        nodes_[max_node].right_ = right_sub_tree;
+      }
+
+      if (right_sub_tree != nil)
+      {
+        nodes_[right_sub_tree].parent_ = root_;
+      }
+
+      if (root_ != nil)
+      {
+        nodes_[root_].parent_ = nil;
+      }
+
+      destroy_node(old_root);
+      --tree_size_;
+    }
+  };
+
+  using node_allocator_type = internal::node_allocator_t<Allocator, node>;
+  using arena_allocator_type = internal::node_allocator_t<Allocator, arena>;
+
+public:
+  class iterator
+  {
+    friend class compact_splay_tree;
+
+  public:
+    using value_type = std::pair<const Key, Data>;
+    using reference = value_type&;
+    using pointer = value_type*;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+
+  protected:
+    arena* arena_ = nullptr;
+    index_type index_ = nil;
+
+  public:
+    iterator() noexcept = default;
+
+    iterator(arena* owner, index_type index) noexcept : arena_{ owner }, index_{ index }
+    {}
+
+    reference operator*() const noexcept
+    {
+      return arena_->nodes_[index_].pair_;
+    }
+
+    pointer operator->() const noexcept
+    {
+      return &arena_->nodes_[index_].pair_;
+    }
+
+    iterator& operator++() noexcept
+    {
+      index_ = arena_->successor(index_);
+      return *this;
+    }
+
+    iterator operator++(int) noexcept
+    {
+      iterator temp = *this;
+      ++*this;
+      return temp;
+    }
+
+    iterator& operator--() noexcept
+    {
+      index_ = index_ == nil ? arena_->sub_tree_max(arena_->root_) : arena_->predecessor(index_);
+      return *this;
+    }
+
+    iterator operator--(int) noexcept
+    {
+      iterator temp = *this;
+      --*this;
+      return temp;
+    }
+
+    bool operator==(const iterator& obj) const noexcept
+    {
+      return index_ == obj.index_;
+    }
+
+    bool operator!=(const iterator& obj) const noexcept
+    {
+      return index_ != obj.index_;
+    }
+  };
+
+  class const_iterator
+  {
+    friend class compact_splay_tree;
+
+  private:
+    iterator it_;
+
+  public:
+    using value_type = std::pair<const Key, Data>;
+    using reference = const value_type&;
+    using pointer = const value_type*;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+
+    const_iterator() noexcept = default;
+
+    const_iterator(iterator it) noexcept : it_{ it }
+    {}
+
+    reference operator*() const noexcept
+    {
+      return *it_;
+    }
+
+    pointer operator->() const noexcept
+    {
+      return it_.operator->();
+    }
+
+    const_iterator& operator++() noexcept
+    {
+      ++it_;
+      return *this;
+    }
+
+    const_iterator operator++(int) noexcept
+    {
+      const_iterator temp = *this;
+      ++it_;
+      return temp;
+    }
+
+    const_iterator& operator--() noexcept
+    {
+      --it_;
+      return *this;
+    }
+
+    const_iterator operator--(int) noexcept
+    {
+      const_iterator temp = *this;
+      --it_;
+      return temp;
+    }
+
+    bool operator==(const const_iterator& obj) const noexcept
+    {
+      return it_ == obj.it_;
+    }
+
+    bool operator!=(const const_iterator& obj) const noexcept
+    {
+      return it_ != obj.it_;
+    }
+  };
+
+private:
+  node_allocator_type node_allocator_;
+  Comparator comparator_;
+  arena* arena_ = create_arena();
+
+private:
+  arena* create_arena()
+  {
+    arena_allocator_type arena_allocator{ node_allocator_ };
+
+    return std::construct_at(arena_allocator.allocate(1));
+  }
+
+  void destroy_arena() noexcept
+  {
+    arena_allocator_type arena_allocator{ node_allocator_ };
+    std::destroy_at(arena_);
+    arena_allocator.deallocate(arena_, 1);
+  }
+
+  // Moves the live elements into new_nodes at the same indices. On failure the moved copies are destroyed again and
+  // the arena is left untouched.
+  void relocate_into(node* new_nodes)
+  {
+    index_type constructed = 0;
+
+    try
+    {
+      for (; constructed < arena_->used_; constructed++)
+      {
+        node& source = arena_->nodes_[constructed];
+        node* target = std::construct_at(new_nodes + constructed);
+        target->parent_ = source.parent_;
+        target->left_ = source.left_;
+        target->right_ = source.right_;
+
+        if (arena_->is_live(constructed))
+        {
+          std::construct_at(std::addressof(target->pair_), std::move_if_noexcept(source.pair_));
+        }
+      }
+    }
+    catch (...)
+    {
+      for (index_type j = 0; j < constructed; j++)
+      {
+        if (arena_->is_live(j))
+        {
+          std::destroy_at(std::addressof(new_nodes[j].pair_));
+        }
+      }
+
+      throw;
+    }
+  }
+
+  // Moves the live elements into a buffer of new_capacity slots at the same indices.
+  void reallocate(index_type new_capacity)
+  {
+    node* new_nodes = node_allocator_.allocate(new_capacity);
+
+    try
+    {
+      relocate_into(new_nodes);
+    }
+    catch (...)
+    {
+      node_allocator_.deallocate(new_nodes, new_capacity);
+      throw;
+    }
+
+    release_nodes();
+    arena_->nodes_ = new_nodes;
+    arena_->capacity_ = new_capacity;
+  }
+
+  template<class... Args>
+  static void construct_element(node* target, const Key& key, Args&&... args)
+  {
+    std::construct_at(target);
+    std::construct_at(std::addressof(target->pair_), std::piecewise_construct, std::forward_as_tuple(key),
+      std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  // Like std::vector::emplace_back, builds the new element in the grown buffer before the old elements move out of
+  // their slots, because key and args may refer to elements of this tree.
+  template<class... Args>
+  void grow_and_construct(const Key& key, Args&&... args)
+  {
+    index_type used = arena_->used_;
+    index_type new_capacity = static_cast<index_type>(std::min<std::size_t>(std::max<std::size_t>(std::size_t{ arena_->capacity_ } * 2, 16), max_capacity));
+    node* new_nodes = node_allocator_.allocate(new_capacity);
+
+    try
+    {
+      construct_element(new_nodes + used, key, std::forward<Args>(args)...);
+
+      try
+      {
+        relocate_into(new_nodes);
+      }
+      catch (...)
+      {
+        std::destroy_at(std::addressof(new_nodes[used].pair_));
+        throw;
+      }
+    }
+    catch (...)
+    {
+      node_allocator_.deallocate(new_nodes, new_capacity);
+      throw;
+    }
+
+    release_nodes();
+    arena_->nodes_ = new_nodes;
+    arena_->capacity_ = new_capacity;
+  }
+
+  // Destroys the live elements and frees the buffer, leaving the rest of the bookkeeping to the caller.
+  void release_nodes() noexcept
+  {
+    if (arena_->nodes_ == nullptr)
+    {
+      return;
+    }
+
+    for (index_type j = 0; j < arena_->used_; j++)
+    {
+      if (arena_->is_live(j))
+      {
+        std::destroy_at(std::addressof(arena_->nodes_[j].pair_));
+      }
+
+      std::destroy_at(arena_->nodes_ + j);
+    }
+
+    node_allocator_.deallocate(arena_->nodes_, arena_->capacity_);
+    arena_->nodes_ = nullptr;
+  }
+
+  template<class... Args>
+  index_type allocate_and_construct_node(const Key& key, Args&&... args)
+  {
+    index_type index = arena_->free_head_;
+
+    if (index == nil)
+    {
+      if (arena_->used_ == max_capacity)
+      {
+        throw std::length_error{ "compact_splay_tree: index space exhausted." };
+      }
+
+      index = arena_->used_;
+
+      if (arena_->used_ == arena_->capacity_)
+      {
+        grow_and_construct(key, std::forward<Args>(args)...);
+      }
+      else
+      {
+        construct_element(arena_->nodes_ + index, key, std::forward<Args>(args)...);
+      }
+
+      ++arena_->used_;
+    }
+    else
+    {
+      std::construct_at(std::addressof(arena_->nodes_[index].pair_), std::piecewise_construct, std::forward_as_tuple(key),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+      arena_->free_head_ = arena_->nodes_[index].left_;
+    }
+
+    node& new_node = arena_->nodes_[index];
+    new_node.parent_ = nil;
+    new_node.left_ = nil;
+    new_node.right_ = nil;
+
+    return index;
+  }
+
+  // Returns the node holding key, or the last node on the search path together with false.
+  std::pair<index_type, bool> locate(const Key& key) const noexcept
+  {
+    const node* nodes = arena_->nodes_;
+    index_type current = arena_->root_, previous = nil;
+
+    while (current != nil)
+    {
+      previous = current;
+      const Key& current_key = nodes[current].pair_.first;
+
+      if (comparator_(key, current_key))
+      {
+        current = nodes[current].left_;
+      }
+      else if (comparator_(current_key, key))
+      {
+        current = nodes[current].right_;
+      }
+      else
+      {
+        return { current, true };
+      }
+    }
+
+    return { previous, false };
+  }
+
+  std::pair<index_type, bool> access(const Key& key) noexcept
+  {
+    auto located = locate(key);
+
+    if (located.first != nil)
+    {
+      arena_->splay(located.first);
+    }
+
+    return located;
+  }
+
+  index_type lower_bound_index(std::pair<index_type, bool> located, const Key& key) const noexcept
+  {
+    auto [target, found] = located;
+
+    if (!found && target != nil && comparator_(arena_->nodes_[target].pair_.first, key))
+    {
+      return arena_->successor(target);
+    }
+
+    return target;
+  }
+
+  index_type upper_bound_index(std::pair<index_type, bool> located, const Key& key) const noexcept
+  {
+    auto [target, found] = located;
+
+    if (found || (target != nil && comparator_(arena_->nodes_[target].pair_.first, key)))
+    {
+      return arena_->successor(target);
+    }
+
+    return target;
+  }
+
+  // Hangs a new node below parent and splays it to the root, as emplace leaves it.
+  template<class... Args>
+  index_type attach_leaf(index_type parent, bool as_left_child, const Key& key, Args&&... args)
+  {
+    index_type new_index = allocate_and_construct_node(key, std::forward<Args>(args)...);
+    node& parent_node = arena_->nodes_[parent];
+    (as_left_child ? parent_node.left_ : parent_node.right_) = new_index;
+    arena_->nodes_[new_index].parent_ = parent;
+    ++arena_->tree_size_;
+    arena_->splay(new_index);
+
+    return new_index;
+  }
+
+  iterator make_iterator(index_type index) const noexcept
+  {
+    return iterator{ arena_, index };
+  }
+
+public:
+  compact_splay_tree() = default;
+
+  explicit compact_splay_tree(const Allocator& alloc)
+    : node_allocator_{ alloc }
+  {}
+
+  explicit compact_splay_tree(const Comparator& comp, const Allocator& alloc = Allocator{})
+    : node_allocator_{ alloc }, comparator_{ comp }
+  {}
+
+  compact_splay_tree(std::initializer_list<value_type> list, const Comparator& comp = Comparator{}, const Allocator& alloc = Allocator{})
+    : compact_splay_tree{ comp, alloc }
+  {
+    insert(list);
+  }
+
+  template<std::input_iterator It>
+  compact_splay_tree(It begin, It end, const Comparator& comp = Comparator{}, const Allocator& alloc = Allocator{})
+    : compact_splay_tree{ comp, alloc }
+  {
+    insert(begin, end);
+  }
+
+  // Copies the arena slot by slot, so the copy has the same shape and indices and needs no comparisons.
+  compact_splay_tree(const compact_splay_tree& obj)
+    : node_allocator_{ std::allocator_traits<node_allocator_type>::select_on_container_copy_construction(obj.node_allocator_) },
+    comparator_{ obj.comparator_ }
+  {
+    const arena& source_arena = *obj.arena_;
+
+    if (source_arena.used_ == 0)
+    {
+      return;
+    }
+
+    try
+    {
+      arena_->nodes_ = node_allocator_.allocate(source_arena.used_);
+      arena_->capacity_ = source_arena.used_;
+
+      for (; arena_->used_ < source_arena.used_; arena_->used_++)
+      {
+        const node& source = source_arena.nodes_[arena_->used_];
+        node* target = std::construct_at(arena_->nodes_ + arena_->used_);
+
+        if (source_arena.is_live(arena_->used_))
+        {
+          std::construct_at(std::addressof(target->pair_), source.pair_);
+        }
+
+        target->parent_ = source.parent_;
+        target->left_ = source.left_;
+        target->right_ = source.right_;
+      }
+    }
+    catch (...)
+    {
+      release_nodes();
+      destroy_arena();
+      throw;
+    }
+
+    arena_->free_head_ = source_arena.free_head_;
+    arena_->root_ = source_arena.root_;
+    arena_->tree_size_ = source_arena.tree_size_;
+  }
+
+  // Takes over obj's arena, so obj's iterators now refer to this tree, and gives obj a new empty one. Allocating that
+  // one means that, unlike splay_tree's, this move constructor can throw.
+  compact_splay_tree(compact_splay_tree&& obj)
+    : node_allocator_{ obj.node_allocator_ }, comparator_{ obj.comparator_ },
+    arena_{ std::exchange(obj.arena_, obj.create_arena()) }
+  {}
+
+  compact_splay_tree& operator=(const compact_splay_tree& obj)
+  {
+    if (&obj == this)
+    {
+      return *this;
+    }
+
+    compact_splay_tree{ obj }.swap(*this);
+
+    return *this;
+  }
+
+  compact_splay_tree& operator=(compact_splay_tree&& obj) noexcept
+  {
+    if (&obj == this)
+    {
+      return *this;
+    }
+
+    swap(obj);
+
+    return *this;
+  }
+
+  ~compact_splay_tree() noexcept
+  {
+    release_nodes();
+    destroy_arena();
+  }
+
+  Data& at(const Key& key)
+  {
+    auto [target, found] = access(key);
+
+    if (!found)
+    {
+      throw std::out_of_range{ "compact_splay_tree: key was out of range." };
+    }
+
+    return arena_->nodes_[target].pair_.second;
+  }
+
+  const Data& at(const Key& key) const
+  {
+    auto [target, found] = locate(key);
+
+    if (!found)
+    {
+      throw std::out_of_range{ "compact_splay_tree: key was out of range." };
+    }
+
+    return arena_->nodes_[target].pair_.second;
+  }
+
+  Data& operator[](const Key& key)
+  {
+    return emplace(key).first->second;
+  }
+
+  iterator find(const Key& key) noexcept
+  {
+    auto [target, found] = access(key);
+
+    return found ? make_iterator(target) : end();
+  }
+
+  const_iterator find(const Key& key) const noexcept
+  {
+    auto [target, found] = locate(key);
+
+    return found ? make_iterator(target) : end();
+  }
+
+  iterator lower_bound(const Key& key) noexcept
+  {
+    return make_iterator(lower_bound_index(access(key), key));
+  }
+
+  const_iterator lower_bound(const Key& key) const noexcept
+  {
+    return make_iterator(lower_bound_index(locate(key), key));
+  }
+
+  iterator upper_bound(const Key& key) noexcept
+  {
+    return make_iterator(upper_bound_index(access(key), key));
+  }
+
+  const_iterator upper_bound(const Key& key) const noexcept
+  {
+    return make_iterator(upper_bound_index(locate(key), key));
+  }
+
+  std::pair<iterator, iterator> equal_range(const Key& key) noexcept
+  {
+    auto located = access(key);
+
+    return { make_iterator(lower_bound_index(located, key)), make_iterator(upper_bound_index(located, key)) };
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(const Key& key) const noexcept
+  {
+    auto located = locate(key);
+
+    return { make_iterator(lower_bound_index(located, key)), make_iterator(upper_bound_index(located, key)) };
+  }
+
+  bool contains(const Key& key) noexcept
+  {
+    return access(key).second;
+  }
+
+  bool contains(const Key& key) const noexcept
+  {
+    return locate(key).second;
+  }
+
+  std::size_t count(const Key& key) noexcept
+  {
+    return access(key).second ? 1 : 0;
+  }
+
+  std::size_t count(const Key& key) const noexcept
+  {
+    return locate(key).second ? 1 : 0;
+  }
+
+  template<class... Args>
+  std::pair<iterator, bool> emplace(const Key& key, Args&&... args)
+  {
+    if (arena_->root_ == nil)
+    {
+      arena_->root_ = allocate_and_construct_node(key, std::forward<Args>(args)...);
+      arena_->tree_size_ = 1;
+
+      return { make_iterator(arena_->root_), true };
+    }
+
+    if (access(key).second)
+    {
+      return { make_iterator(arena_->root_), false };
+    }
+
+    index_type old_root = arena_->root_;
+    index_type new_index = allocate_and_construct_node(key, std::forward<Args>(args)...);
+    node& new_node = arena_->nodes_[new_index];
+    node& old_root_node = arena_->nodes_[old_root];
+
+    if (comparator_(key, old_root_node.pair_.first))
+    {
+      new_node.left_ = old_root_node.left_;
+      new_node.right_ = old_root;
+      old_root_node.left_ = nil;
+    }
+    else
+    {
+      new_node.right_ = old_root_node.right_;
+      new_node.left_ = old_root;
+      old_root_node.right_ = nil;
+    }
+
+    old_root_node.parent_ = new_index;
+
+    if (new_node.left_ != nil)
+    {
+      arena_->nodes_[new_node.left_].parent_ = new_index;
+    }
+
+    if (new_node.right_ != nil)
+    {
+      arena_->nodes_[new_node.right_].parent_ = new_index;
+    }
+
+    arena_->root_ = new_index;
+    ++arena_->tree_size_;
+
+    return { make_iterator(new_index), true };
+  }
+
+  // A correct hint is the element just after or just before the new one; the new node then hangs off the hint or its
+  // neighbour without a search from the root. A wrong hint falls back to emplace.
+  template<class... Args>
+  iterator emplace_hint(const_iterator hint, const Key& key, Args&&... args)
+  {
+    index_type hint_index = hint.it_.index_;
+    const node* nodes = arena_->nodes_;
+
+    if (arena_->root_ == nil)
+    {
+      return emplace(key, std::forward<Args>(args)...).first;
+    }
+
+    if (hint_index == nil || comparator_(key, nodes[hint_index].pair_.first))
+    {
+      index_type prev_index = hint_index == nil ? arena_->sub_tree_max(arena_->root_) : arena_->predecessor(hint_index);
+
+      if (prev_index == nil || comparator_(nodes[prev_index].pair_.first, key))
+      {
+        bool as_left_child = hint_index != nil && nodes[hint_index].left_ == nil;
+
+        return make_iterator(attach_leaf(as_left_child ? hint_index : prev_index, as_left_child, key, std::forward<Args>(args)...));
+      }
+    }
+    else if (comparator_(nodes[hint_index].pair_.first, key))
+    {
+      index_type next_index = arena_->successor(hint_index);
+
+      if (next_index == nil || comparator_(key, nodes[next_index].pair_.first))
+      {
+        bool as_left_child = nodes[hint_index].right_ != nil;
+
+        return make_iterator(attach_leaf(as_left_child ? next_index : hint_index, as_left_child, key, std::forward<Args>(args)...));
+      }
+    }
+    else
+    {
+      arena_->splay(hint_index);
+
+      return make_iterator(hint_index);
+    }
+
+    return emplace(key, std::forward<Args>(args)...).first;
+  }
+
+  template<class Pair>
+  std::pair<iterator, bool> insert(Pair&& data)
+  {
+    return emplace(data.first, data.second);
+  }
+
+  template<class Pair>
+  iterator insert(const_iterator hint, Pair&& data)
+  {
+    return emplace_hint(hint, data.first, data.second);
+  }
+
+  template<std::input_iterator It>
+  void insert(It begin, It end)
+  {
+    for (; begin != end; ++begin)
+    {
+      insert(*begin);
+    }
+  }
+
+  template<std::ranges::input_range Range>
+  void insert(Range&& range)
+  {
+    insert(std::begin(range), std::end(range));
+  }
+
+  // Like std::map::merge, moves over the elements whose keys are missing here and leaves the rest in obj. Two arenas
+  // cannot share slots, so every element moves into a new slot of this tree and its old slot is freed in obj.
+  void merge(compact_splay_tree& obj)
+  {
+    if (&obj == this)
+    {
+      return;
+    }
+
+    for (iterator it = obj.begin(); it != obj.end();)
+    {
+      it = emplace(it->first, std::move(it->second)).second ? obj.erase(it) : std::next(it);
+    }
+  }
+
+  void merge(compact_splay_tree&& obj)
+  {
+    merge(obj);
+  }
+
+  iterator erase(iterator it) noexcept
+  {
+    iterator next = it;
+    ++next;
+    arena_->splay(it.index_);
+    arena_->remove_root();
+
+    return next;
+  }
+
+  iterator erase(iterator begin, iterator end) noexcept
+  {
+    while (begin != end)
+    {
+      begin = erase(begin);
+    }
+
+    return end;
+  }
+
+  bool erase(const Key& key) noexcept
+  {
+    if (arena_->root_ == nil || !access(key).second)
+    {
+      return false;
+    }
+
+    arena_->remove_root();
+
+    return true;
+  }
+
+  void clear() noexcept
+  {
+    arena_->destroy_slots();
+  }
+
+  void reserve(std::size_t count)
+  {
+    if (count > max_capacity)
+    {
+      throw std::length_error{ "compact_splay_tree: index space exhausted." };
+    }
+
+    if (count > arena_->capacity_)
+    {
+      reallocate(static_cast<index_type>(count));
+    }
+  }
+
+  void swap(compact_splay_tree& obj) noexcept
+  {
+    std::swap(node_allocator_, obj.node_allocator_);
+    std::swap(comparator_, obj.comparator_);
+    std::swap(arena_, obj.arena_);
+  }
+
+  allocator_type get_allocator() const noexcept
+  {
+    return allocator_type{ node_allocator_ };
+  }
+
+  [[nodiscard]] bool empty() const noexcept
+  {
+    return arena_->tree_size_ == 0;
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept
+  {
+    return arena_->tree_size_;
+  }
+
+  [[nodiscard]] std::size_t capacity() const noexcept
+  {
+    return arena_->capacity_;
+  }
+
+  iterator begin() noexcept
+  {
+    return make_iterator(arena_->sub_tree_min(arena_->root_));
+  }
+
+  iterator end() noexcept
+  {
+    return make_iterator(nil);
+  }
+
+  [[nodiscard]] const_iterator begin() const noexcept
+  {
+    return make_iterator(arena_->sub_tree_min(arena_->root_));
+  }
+
+  [[nodiscard]] const_iterator end() const noexcept
+  {
+    return make_iterator(nil);
+  }
+
+  [[nodiscard]] const_iterator cbegin() const noexcept
+  {
+    return begin();
+  }
+
+  [[nodiscard]] const_iterator cend() const noexcept
+  {
+    return end();
+  }
+};
@@ -0,0 +1,531 @@
+#pragma once
+#include "splay_tree.hpp"
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <iterator>
+#include <utility>
+#include <tuple>
+
+// A splay tree whose nodes are shared between snapshots. snapshot() and copying take O(1); every write first copies
+// the shared nodes on its search path, so a snapshot handed to another thread keeps seeing the tree as it was while
+// the original keeps splaying. Nodes carry atomic reference counts and are freed by whichever tree drops the last
+// reference, so the allocator must tolerate deallocation from the threads that release snapshots.
+template<class Key, class Data, class Comparator = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, Data>>>
+class cow_splay_tree
+{
+public:
+  using key_type = Key;
+  using mapped_type = Data;
+  using value_type = std::pair<const Key, Data>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using key_compare = Comparator;
+  using allocator_type = Allocator;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+private:
+  struct node
+  {
+    std::atomic<std::size_t> references = 1;
+    node* left_ = nullptr;
+    node* right_ = nullptr;
+    value_type pair_;
+
+    template<class... Args>
+    explicit node(Args&&... args) : pair_{ std::forward<Args>(args)... }
+    {}
+  };
+
+  using node_allocator_type = internal::node_allocator_t<Allocator, node>;
+
+public:
+  // Walks the tree with an explicit stack of the ancestors still to be visited, since nodes have no parent pointers.
+  class const_iterator
+  {
+    friend class cow_splay_tree;
+
+  private:
+    std::vector<const node*> stack_;
+
+  private:
+    void push_left_spine(const node* current_node)
+    {
+      for (; current_node != nullptr; current_node = current_node->left_)
+      {
+        stack_.push_back(current_node);
+      }
+    }
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename cow_splay_tree::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    const_iterator() = default;
+
+    reference operator*() const noexcept
+    {
+      return stack_.back()->pair_;
+    }
+
+    pointer operator->() const noexcept
+    {
+      return &stack_.back()->pair_;
+    }
+
+    const_iterator& operator++()
+    {
+      const node* current_node = stack_.back();
+      stack_.pop_back();
+      push_left_spine(current_node->right_);
+
+      return *this;
+    }
+
+    const_iterator operator++(int)
+    {
+      const_iterator temp = *this;
+      ++*this;
+
+      return temp;
+    }
+
+    friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) noexcept
+    {
+      if (lhs.stack_.empty() || rhs.stack_.empty())
+      {
+        return lhs.stack_.empty() == rhs.stack_.empty();
+      }
+
+      return lhs.stack_.back() == rhs.stack_.back();
+    }
+  };
+
+  using iterator = const_iterator;
+
+private:
+  node_allocator_type node_allocator_;
+  Comparator comparator_;
+  node* root_ = {};
+  std::size_t tree_size_ = {};
+
+private:
+  template<class... Args>
+  node* allocate_and_construct_node(Args&&... args)
+  {
+    node* result = node_allocator_.allocate(1);
+
+    try
+    {
+      std::construct_at(result, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+      node_allocator_.deallocate(result, 1);
+      throw;
+    }
+
+    return result;
+  }
+
+  void destroy_node(node* target_node) noexcept
+  {
+    std::destroy_at(target_node);
+    node_allocator_.deallocate(target_node, 1);
+  }
+
+  static void acquire(node* target_node) noexcept
+  {
+    if (target_node != nullptr)
+    {
+      target_node->references.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  // Drops one reference and frees every node that becomes unreachable. The freed nodes themselves serve as the stack
+  // of right subtrees still to be released, so reclamation neither recurses nor allocates.
+  void release(node* sub_tree_root) noexcept
+  {
+    node* pending = nullptr;
+    node* current_node = sub_tree_root;
+
+    while (true)
+    {
+      if (current_node != nullptr && current_node->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        node* left_child = current_node->left_;
+        current_node->left_ = pending;
+        pending = current_node;
+        current_node = left_child;
+        continue;
+      }
+
+      if (pending == nullptr)
+      {
+        break;
+      }
+
+      node* dead_node = pending;
+      pending = dead_node->left_;
+      current_node = dead_node->right_;
+      destroy_node(dead_node);
+    }
+  }
+
+  node* make_exclusive(node* target_node)
+  {
+    if (target_node->references.load(std::memory_order_acquire) == 1)
+    {
+      return target_node;
+    }
+
+    node* result = allocate_and_construct_node(target_node->pair_);
+    result->left_ = target_node->left_;
+    result->right_ = target_node->right_;
+    acquire(result->left_);
+    acquire(result->right_);
+    release(target_node);
+
+    return result;
+  }
+
+  // Copies every shared node on the search path of key, so the splay that follows only touches exclusive nodes.
+  void make_path_exclusive(node** link, const Key& key)
+  {
+    while (*link != nullptr)
+    {
+      node* current_node = make_exclusive(*link);
+      *link = current_node;
+
+      if (comparator_(key, current_node->pair_.first))
+      {
+        link = &current_node->left_;
+      }
+      else if (comparator_(current_node->pair_.first, key))
+      {
+        link = &current_node->right_;
+      }
+      else
+      {
+        break;
+      }
+    }
+  }
+
+  node* splay(node* sub_tree_root, const Key& key) noexcept
+  {
+    node* left_tree_root = nullptr;
+    node* right_tree_root = nullptr;
+    node** left_tree_hook = &left_tree_root;
+    node** right_tree_hook = &right_tree_root;
+    node* current_node = sub_tree_root;
+
+    while (true)
+    {
+      if (comparator_(key, current_node->pair_.first))
+      {
+        node* child = current_node->left_;
+
+        if (child == nullptr)
+        {
+          break;
+        }
+
+        if (comparator_(key, child->pair_.first))
+        {
+          current_node->left_ = child->right_;
+          child->right_ = current_node;
+          current_node = child;
+
+          if (current_node->left_ == nullptr)
+          {
+            break;
+          }
+        }
+
+        node* next_node = current_node->left_;
+        *right_tree_hook = current_node;
+        right_tree_hook = &current_node->left_;
+        current_node = next_node;
+      }
+      else if (comparator_(current_node->pair_.first, key))
+      {
+        node* child = current_node->right_;
+
+        if (child == nullptr)
+        {
+          break;
+        }
+
+        if (comparator_(child->pair_.first, key))
+        {
+          current_node->right_ = child->left_;
+          child->left_ = current_node;
+          current_node = child;
+
+          if (current_node->right_ == nullptr)
+          {
+            break;
+          }
+        }
+
+        node* next_node = current_node->right_;
+        *left_tree_hook = current_node;
+        left_tree_hook = &current_node->right_;
+        current_node = next_node;
+      }
+      else
+      {
+        break;
+      }
+    }
+
+    *left_tree_hook = current_node->left_;
+    *right_tree_hook = current_node->right_;
+    current_node->left_ = left_tree_root;
+    current_node->right_ = right_tree_root;
+
+    return current_node;
+  }
+
+  bool splay_root(const Key& key)
+  {
+    make_path_exclusive(&root_, key);
+    root_ = splay(root_, key);
+
+    return !comparator_(key, root_->pair_.first) && !comparator_(root_->pair_.first, key);
+  }
+
+  const_iterator iterator_to_root() const
+  {
+    const_iterator result;
+    result.stack_.push_back(root_);
+
+    return result;
+  }
+
+public:
+  cow_splay_tree() = default;
+
+  explicit cow_splay_tree(const Comparator& comp, const Allocator& alloc = Allocator{})
+    : node_allocator_{ alloc }, comparator_{ comp }
+  {}
+
+  cow_splay_tree(std::initializer_list<value_type> list, const Comparator& comp = Comparator{}, const Allocator& alloc = Allocator{})
+    : node_allocator_{ alloc }, comparator_{ comp }
+  {
+    for (const auto& [key, value] : list)
+    {
+      emplace(key, value);
+    }
+  }
+
+  // Shares every node with obj; the nodes are copied lazily by whichever tree writes to them first.
+  cow_splay_tree(const cow_splay_tree& obj) noexcept
+    : node_allocator_{ obj.node_allocator_ }, comparator_{ obj.comparator_ }, root_{ obj.root_ }, tree_size_{ obj.tree_size_ }
+  {
+    acquire(root_);
+  }
+
+  cow_splay_tree(cow_splay_tree&& obj) noexcept
+  {
+    swap(obj);
+  }
+
+  cow_splay_tree& operator=(cow_splay_tree obj) noexcept
+  {
+    swap(obj);
+
+    return *this;
+  }
+
+  ~cow_splay_tree() noexcept
+  {
+    release(root_);
+  }
+
+  cow_splay_tree snapshot() const noexcept
+  {
+    return *this;
+  }
+
+  template<class... Args>
+  std::pair<const_iterator, bool> emplace(const Key& key, Args&&... args)
+  {
+    if (root_ == nullptr)
+    {
+      root_ = allocate_and_construct_node(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+      tree_size_ = 1;
+
+      return { iterator_to_root(), true };
+    }
+
+    if (splay_root(key))
+    {
+      return { iterator_to_root(), false };
+    }
+
+    node* new_node = allocate_and_construct_node(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+
+    if (comparator_(key, root_->pair_.first))
+    {
+      new_node->left_ = root_->left_;
+      new_node->right_ = root_;
+      root_->left_ = nullptr;
+    }
+    else
+    {
+      new_node->right_ = root_->right_;
+      new_node->left_ = root_;
+      root_->right_ = nullptr;
+    }
+
+    root_ = new_node;
+    ++tree_size_;
+
+    return { iterator_to_root(), true };
+  }
+
+  template<class Value>
+  bool insert_or_assign(const Key& key, Value&& value)
+  {
+    auto [it, inserted] = emplace(key, std::forward<Value>(value));
+
+    if (!inserted)
+    {
+      root_->pair_.second = std::forward<Value>(value);
+    }
+
+    return inserted;
+  }
+
+  bool erase(const Key& key)
+  {
+    if (root_ == nullptr || !splay_root(key))
+    {
+      return false;
+    }
+
+    node* old_root = root_;
+
+    if (old_root->left_ == nullptr)
+    {
+      root_ = old_root->right_;
+    }
+    else
+    {
+      make_path_exclusive(&old_root->left_, key);
+      root_ = splay(old_root->left_, key);
+      root_->right_ = old_root->right_;
+    }
+
+    destroy_node(old_root);
+    --tree_size_;
+
+    return true;
+  }
+
+  const_iterator find(const Key& key)
+  {
+    if (root_ == nullptr || !splay_root(key))
+    {
+      return end();
+    }
+
+    return iterator_to_root();
+  }
+
+  const_iterator find(const Key& key) const
+  {
+    const_iterator result = lower_bound(key);
+
+    if (result != end() && comparator_(key, result->first))
+    {
+      return end();
+    }
+
+    return result;
+  }
+
+  const_iterator lower_bound(const Key& key) const
+  {
+    const_iterator result;
+
+    for (const node* current_node = root_; current_node != nullptr;)
+    {
+      if (comparator_(current_node->pair_.first, key))
+      {
+        current_node = current_node->right_;
+      }
+      else
+      {
+        result.stack_.push_back(current_node);
+        current_node = current_node->left_;
+      }
+    }
+
+    return result;
+  }
+
+  bool contains(const Key& key)
+  {
+    return root_ != nullptr && splay_root(key);
+  }
+
+  bool contains(const Key& key) const
+  {
+    return find(key) != end();
+  }
+
+  void clear() noexcept
+  {
+    release(root_);
+    root_ = nullptr;
+    tree_size_ = 0;
+  }
+
+  void swap(cow_splay_tree& obj) noexcept
+  {
+    std::swap(node_allocator_, obj.node_allocator_);
+    std::swap(comparator_, obj.comparator_);
+    std::swap(root_, obj.root_);
+    std::swap(tree_size_, obj.tree_size_);
+  }
+
+  bool empty() const noexcept
+  {
+    return tree_size_ == 0;
+  }
+
+  std::size_t size() const noexcept
+  {
+    return tree_size_;
+  }
+
+  const_iterator begin() const
+  {
+    const_iterator result;
+    result.push_left_spine(root_);
+
+    return result;
+  }
+
+  const_iterator end() const noexcept
+  {
+    return {};
+  }
+
+  const_iterator cbegin() const
+  {
+    return begin();
+  }
+
+  const_iterator cend() const noexcept
+  {
+    return {};
+  }
+};
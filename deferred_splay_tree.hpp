@@ -0,0 +1,239 @@
+#pragma once
+#include "splay_tree.hpp"
+#include <shared_mutex>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <optional>
+#include <cstdint>
+
+// Readers share the tree and use the non-rotating const lookups, recording the accessed keys in per-thread logs.
+// Writers, and explicit restructure() calls, take the tree exclusively and first replay the logged accesses as
+// ordinary splaying lookups, so the tree still adapts to the read pattern.
+template<class Key, class Data, class Comparator = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, Data>>,
+  class SplayPolicy = splay_policy::top_down, class Augmentation = splay_augmentation::none, class Stats = splay_stats::none>
+class deferred_splay_tree
+{
+  static_assert(!Augmentation::is_lazy, "const lookups push pending range tags, so lazily tagged trees cannot be read concurrently");
+  static_assert(!Stats::enabled, "const lookups update the statistics, so instrumented trees cannot be read concurrently");
+
+public:
+  using tree_type = splay_tree<Key, Data, Comparator, Allocator, SplayPolicy, Augmentation, Stats>;
+  using key_type = Key;
+  using mapped_type = Data;
+  using value_type = std::pair<const Key, Data>;
+  using size_type = std::size_t;
+
+private:
+  struct access_log
+  {
+    std::vector<Key> keys;
+    std::atomic<bool> orphaned = false;
+  };
+
+  // Owns the logs of every thread that has read the tree. The mutex only serializes registration.
+  struct log_registry
+  {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<access_log>> logs;
+  };
+
+  struct cached_log
+  {
+    std::uint64_t owner;
+    std::weak_ptr<log_registry> registry;
+    access_log* log;
+  };
+
+  // Marks the logs of an exiting thread as orphaned, so the next replay drains them one last time and frees them.
+  struct thread_log_cache
+  {
+    std::vector<cached_log> entries;
+
+    ~thread_log_cache()
+    {
+      for (cached_log& entry : entries)
+      {
+        // A live registry only frees a log after seeing this mark, so the log outlives the store.
+        if (auto registry = entry.registry.lock())
+        {
+          entry.log->orphaned.store(true, std::memory_order_release);
+        }
+      }
+    }
+  };
+
+  tree_type tree_;
+  mutable std::shared_mutex tree_mutex_;
+  std::shared_ptr<log_registry> registry_;
+  std::uint64_t id_;
+  std::size_t log_capacity_;
+
+private:
+  static std::uint64_t next_id() noexcept
+  {
+    static std::atomic<std::uint64_t> next = 0;
+
+    return next.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // One cache per thread and specialization, shared by every instance of the specialization, hence keyed by instance
+  // id. Ids are never reused, and entries of destroyed trees are pruned whenever the thread registers a new log.
+  static std::vector<cached_log>& thread_logs()
+  {
+    thread_local thread_log_cache cache;
+
+    return cache.entries;
+  }
+
+  access_log& local_log()
+  {
+    std::vector<cached_log>& logs = thread_logs();
+
+    for (const cached_log& entry : logs)
+    {
+      if (entry.owner == id_)
+      {
+        return *entry.log;
+      }
+    }
+
+    std::erase_if(logs, [](const cached_log& entry) { return entry.registry.expired(); });
+    logs.reserve(logs.size() + 1);
+
+    auto log = std::make_unique<access_log>();
+    log->keys.reserve(log_capacity_);
+    access_log* result = log.get();
+
+    {
+      std::lock_guard lock{ registry_->mutex };
+      registry_->logs.push_back(std::move(log));
+    }
+
+    logs.push_back({ id_, registry_, result });
+
+    return *result;
+  }
+
+  // Runs under the shared lock. Only the owning thread appends to its log and writers drain the logs under the
+  // exclusive lock, so appending takes no lock. Accesses beyond the capacity are dropped until the next replay.
+  void record(const Key& key)
+  {
+    access_log& log = local_log();
+
+    if (log.keys.size() < log_capacity_)
+    {
+      log.keys.push_back(key);
+    }
+  }
+
+  // Runs under the exclusive lock, so no reader appends to a log or registers a new one meanwhile.
+  void replay()
+  {
+    for (auto& log : registry_->logs)
+    {
+      for (const Key& key : log->keys)
+      {
+        tree_.find(key);
+      }
+
+      log->keys.clear();
+    }
+
+    std::erase_if(registry_->logs, [](const std::unique_ptr<access_log>& log) { return log->orphaned.load(std::memory_order_acquire); });
+  }
+
+public:
+  explicit deferred_splay_tree(std::size_t log_capacity = 1024, const Comparator& comp = Comparator{}, const Allocator& alloc = Allocator{})
+    : tree_{ {}, comp, alloc }, registry_{ std::make_shared<log_registry>() }, id_{ next_id() }, log_capacity_{ log_capacity }
+  {}
+
+  deferred_splay_tree(const deferred_splay_tree&) = delete;
+  deferred_splay_tree& operator=(const deferred_splay_tree&) = delete;
+
+  std::optional<Data> find(const Key& key)
+  {
+    std::shared_lock lock{ tree_mutex_ };
+    auto it = std::as_const(tree_).find(key);
+    record(key);
+
+    if (it == tree_.cend())
+    {
+      return std::nullopt;
+    }
+
+    return it->second;
+  }
+
+  bool contains(const Key& key)
+  {
+    std::shared_lock lock{ tree_mutex_ };
+    record(key);
+
+    return std::as_const(tree_).contains(key);
+  }
+
+  std::optional<value_type> lower_bound(const Key& key)
+  {
+    std::shared_lock lock{ tree_mutex_ };
+    auto it = std::as_const(tree_).lower_bound(key);
+    record(key);
+
+    if (it == tree_.cend())
+    {
+      return std::nullopt;
+    }
+
+    return *it;
+  }
+
+  template<class... Args>
+  bool emplace(const Key& key, Args&&... args)
+  {
+    std::unique_lock lock{ tree_mutex_ };
+    replay();
+
+    return tree_.emplace(key, std::forward<Args>(args)...).second;
+  }
+
+  bool erase(const Key& key)
+  {
+    std::unique_lock lock{ tree_mutex_ };
+    replay();
+
+    return tree_.erase(key);
+  }
+
+  void restructure()
+  {
+    std::unique_lock lock{ tree_mutex_ };
+    replay();
+  }
+
+  // The number of per-thread access logs the tree keeps; logs of exited threads are dropped by the next replay.
+  std::size_t access_log_count() const
+  {
+    std::shared_lock lock{ tree_mutex_ };
+    std::lock_guard registry_lock{ registry_->mutex };
+
+    return registry_->logs.size();
+  }
+
+  std::size_t size() const
+  {
+    std::shared_lock lock{ tree_mutex_ };
+
+    return tree_.size();
+  }
+
+  // Runs the function on the underlying tree with exclusive access, after replaying the logged accesses.
+  template<class Function>
+  decltype(auto) with_tree(Function&& function)
+  {
+    std::unique_lock lock{ tree_mutex_ };
+    replay();
+
+    return function(tree_);
+  }
+};
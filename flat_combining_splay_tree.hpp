@@ -0,0 +1,309 @@
+#pragma once
+#include "splay_tree.hpp"
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <array>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <exception>
+
+// Threads publish their requests into slots, and whichever thread acquires the combiner lock applies every pending
+// request as one batch sorted by key, so neighbouring keys are served by consecutive, cheap splays.
+template<class Key, class Data, class Comparator = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, Data>>,
+  class SplayPolicy = splay_policy::top_down, class Augmentation = splay_augmentation::none, std::size_t SlotCount = 64,
+  class Stats = splay_stats::none>
+class flat_combining_splay_tree
+{
+public:
+  using tree_type = splay_tree<Key, Data, Comparator, Allocator, SplayPolicy, Augmentation, Stats>;
+  using key_type = Key;
+  using mapped_type = Data;
+  using size_type = std::size_t;
+
+private:
+  enum class operation
+  {
+    find,
+    contains,
+    emplace,
+    erase
+  };
+
+  enum class slot_state
+  {
+    empty,
+    claimed,
+    pending,
+    done
+  };
+
+  struct alignas(64) slot
+  {
+    std::atomic<slot_state> state = slot_state::empty;
+    operation request = operation::find;
+    const Key* key = nullptr;
+    Data* argument = nullptr;
+    bool success = false;
+    std::optional<Data> value;
+    std::exception_ptr error;
+  };
+
+  Comparator comparator_;
+  tree_type tree_;
+  std::array<slot, SlotCount> slots_;
+  std::mutex combiner_mutex_;
+  std::vector<slot*> batch_;
+
+private:
+  static std::size_t home_slot() noexcept
+  {
+    static std::atomic<std::size_t> next_slot = 0;
+    thread_local std::size_t index = next_slot.fetch_add(1, std::memory_order_relaxed) % SlotCount;
+
+    return index;
+  }
+
+  void combine()
+  {
+    batch_.clear();
+
+    for (slot& current_slot : slots_)
+    {
+      if (current_slot.state.load(std::memory_order_acquire) == slot_state::pending)
+      {
+        batch_.push_back(&current_slot);
+      }
+    }
+
+    // Sorting only makes the batch cheaper to apply, so a throwing comparator leaves it in publication order.
+    try
+    {
+      std::ranges::sort(batch_, [this](const slot* lhs, const slot* rhs) { return comparator_(*lhs->key, *rhs->key); });
+    }
+    catch (...)
+    {}
+
+    // A failed request must not strand the rest of the batch, so its exception is handed back to the owning thread.
+    for (slot* current_slot : batch_)
+    {
+      try
+      {
+        apply(*current_slot);
+      }
+      catch (...)
+      {
+        current_slot->error = std::current_exception();
+      }
+
+      current_slot->state.store(slot_state::done, std::memory_order_release);
+    }
+  }
+
+  void apply(slot& request_slot)
+  {
+    const Key& key = *request_slot.key;
+
+    switch (request_slot.request)
+    {
+    case operation::find:
+    {
+      auto it = tree_.find(key);
+      request_slot.success = it != tree_.end();
+
+      if (request_slot.success)
+      {
+        request_slot.value = it->second;
+      }
+      break;
+    }
+    case operation::contains:
+      request_slot.success = tree_.contains(key);
+      break;
+    case operation::emplace:
+      request_slot.success = tree_.emplace(key, std::move(*request_slot.argument)).second;
+      break;
+    case operation::erase:
+      request_slot.success = tree_.erase(key);
+      break;
+    }
+  }
+
+  slot& execute(operation request, const Key& key, Data* argument = nullptr)
+  {
+    slot& own_slot = slots_[home_slot()];
+    slot_state expected = slot_state::empty;
+
+    while (!own_slot.state.compare_exchange_weak(expected, slot_state::claimed, std::memory_order_acquire, std::memory_order_relaxed))
+    {
+      expected = slot_state::empty;
+      std::this_thread::yield();
+    }
+
+    own_slot.request = request;
+    own_slot.key = &key;
+    own_slot.argument = argument;
+    own_slot.value.reset();
+    own_slot.error = nullptr;
+    own_slot.state.store(slot_state::pending, std::memory_order_release);
+
+    while (own_slot.state.load(std::memory_order_acquire) != slot_state::done)
+    {
+      std::unique_lock combiner_lock{ combiner_mutex_, std::try_to_lock };
+
+      if (combiner_lock.owns_lock())
+      {
+        combine();
+      }
+      else
+      {
+        std::this_thread::yield();
+      }
+    }
+
+    if (own_slot.error != nullptr)
+    {
+      std::exception_ptr error = std::exchange(own_slot.error, nullptr);
+      release(own_slot, false);
+      std::rethrow_exception(error);
+    }
+
+    return own_slot;
+  }
+
+  template<class Result>
+  static Result release(slot& own_slot, Result result) noexcept
+  {
+    own_slot.state.store(slot_state::empty, std::memory_order_release);
+
+    return result;
+  }
+
+public:
+  explicit flat_combining_splay_tree(const Comparator& comp = Comparator{}, const Allocator& alloc = Allocator{})
+    : comparator_{ comp }, tree_{ {}, comp, alloc }
+  {
+    batch_.reserve(SlotCount);
+  }
+
+  flat_combining_splay_tree(const flat_combining_splay_tree&) = delete;
+  flat_combining_splay_tree& operator=(const flat_combining_splay_tree&) = delete;
+
+  std::optional<Data> find(const Key& key)
+  {
+    slot& own_slot = execute(operation::find, key);
+
+    return release(own_slot, std::move(own_slot.value));
+  }
+
+  bool contains(const Key& key)
+  {
+    slot& own_slot = execute(operation::contains, key);
+
+    return release(own_slot, own_slot.success);
+  }
+
+  bool emplace(const Key& key, Data value)
+  {
+    slot& own_slot = execute(operation::emplace, key, &value);
+
+    return release(own_slot, own_slot.success);
+  }
+
+  bool erase(const Key& key)
+  {
+    slot& own_slot = execute(operation::erase, key);
+
+    return release(own_slot, own_slot.success);
+  }
+
+  std::size_t size()
+  {
+    std::lock_guard lock{ combiner_mutex_ };
+
+    return tree_.size();
+  }
+
+  // Runs the function on the underlying tree while no batch is being combined.
+  template<class Function>
+  decltype(auto) with_tree(Function&& function)
+  {
+    std::lock_guard lock{ combiner_mutex_ };
+
+    return function(tree_);
+  }
+};
+
+// The baseline the flat-combining front end is measured against: every operation takes one mutex.
+template<class Key, class Data, class Comparator = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, Data>>,
+  class SplayPolicy = splay_policy::top_down, class Augmentation = splay_augmentation::none, class Stats = splay_stats::none>
+class locked_splay_tree
+{
+public:
+  using tree_type = splay_tree<Key, Data, Comparator, Allocator, SplayPolicy, Augmentation, Stats>;
+  using key_type = Key;
+  using mapped_type = Data;
+  using size_type = std::size_t;
+
+private:
+  tree_type tree_;
+  std::mutex mutex_;
+
+public:
+  explicit locked_splay_tree(const Comparator& comp = Comparator{}, const Allocator& alloc = Allocator{})
+    : tree_{ {}, comp, alloc }
+  {}
+
+  locked_splay_tree(const locked_splay_tree&) = delete;
+  locked_splay_tree& operator=(const locked_splay_tree&) = delete;
+
+  std::optional<Data> find(const Key& key)
+  {
+    std::lock_guard lock{ mutex_ };
+    auto it = tree_.find(key);
+
+    if (it == tree_.end())
+    {
+      return std::nullopt;
+    }
+
+    return it->second;
+  }
+
+  bool contains(const Key& key)
+  {
+    std::lock_guard lock{ mutex_ };
+
+    return tree_.contains(key);
+  }
+
+  bool emplace(const Key& key, Data value)
+  {
+    std::lock_guard lock{ mutex_ };
+
+    return tree_.emplace(key, std::move(value)).second;
+  }
+
+  bool erase(const Key& key)
+  {
+    std::lock_guard lock{ mutex_ };
+
+    return tree_.erase(key);
+  }
+
+  std::size_t size()
+  {
+    std::lock_guard lock{ mutex_ };
+
+    return tree_.size();
+  }
+
+  template<class Function>
+  decltype(auto) with_tree(Function&& function)
+  {
+    std::lock_guard lock{ mutex_ };
+
+    return function(tree_);
+  }
+};
@@ -0,0 +1,263 @@
+#pragma once
+#include "splay_tree.hpp"
+#include <mutex>
+#include <shared_mutex>
+#include <memory>
+#include <vector>
+#include <optional>
+#include <algorithm>
+
+// Partitions the key space into independent splay trees, each guarded by its own mutex and owning its own allocator.
+// Shard i holds the keys in [boundaries[i - 1], boundaries[i]); rebalance() moves the boundaries so that the shards
+// hold roughly the same number of elements. Every operation holds the boundaries in shared mode, so only rebalance()
+// excludes the rest of the tree.
+template<class Key, class Data, class Comparator = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, Data>>,
+  class SplayPolicy = splay_policy::top_down, class Augmentation = splay_augmentation::none, class Stats = splay_stats::none>
+class sharded_splay_tree
+{
+public:
+  using tree_type = splay_tree<Key, Data, Comparator, Allocator, SplayPolicy, Augmentation, Stats>;
+  using key_type = Key;
+  using mapped_type = Data;
+  using value_type = std::pair<const Key, Data>;
+  using size_type = std::size_t;
+  using key_compare = Comparator;
+  using allocator_type = Allocator;
+
+private:
+  struct shard
+  {
+    mutable std::mutex mutex;
+    tree_type tree;
+  };
+
+  Comparator comparator_;
+  std::size_t shard_count_;
+  std::unique_ptr<shard[]> shards_;
+  std::vector<Key> boundaries_;
+  mutable std::shared_mutex boundaries_mutex_;
+
+private:
+  std::size_t shard_for(const Key& key) const
+  {
+    return static_cast<std::size_t>(std::ranges::upper_bound(boundaries_, key, comparator_) - boundaries_.begin());
+  }
+
+  template<class Operation>
+  decltype(auto) with_shard(const Key& key, Operation&& operation)
+  {
+    std::shared_lock boundaries_lock{ boundaries_mutex_ };
+    shard& target = shards_[shard_for(key)];
+    std::lock_guard shard_lock{ target.mutex };
+
+    return operation(target.tree);
+  }
+
+public:
+  explicit sharded_splay_tree(std::size_t shard_count, const Comparator& comp = Comparator{}, const Allocator& alloc = Allocator{})
+    : comparator_{ comp }, shard_count_{ std::max<std::size_t>(shard_count, 1) }, shards_{ std::make_unique<shard[]>(shard_count_) }
+  {
+    for (std::size_t j = 0; j < shard_count_; j++)
+    {
+      shards_[j].tree = tree_type{ {}, comp, std::allocator_traits<Allocator>::select_on_container_copy_construction(alloc) };
+    }
+  }
+
+  explicit sharded_splay_tree(std::vector<Key> boundaries, const Comparator& comp = Comparator{}, const Allocator& alloc = Allocator{})
+    : sharded_splay_tree(boundaries.size() + 1, comp, alloc)
+  {
+    std::ranges::sort(boundaries, comparator_);
+    boundaries_ = std::move(boundaries);
+  }
+
+  sharded_splay_tree(const sharded_splay_tree&) = delete;
+  sharded_splay_tree& operator=(const sharded_splay_tree&) = delete;
+
+  template<class... Args>
+  bool emplace(const Key& key, Args&&... args)
+  {
+    return with_shard(key, [&](tree_type& tree) { return tree.emplace(key, std::forward<Args>(args)...).second; });
+  }
+
+  bool insert(const value_type& value)
+  {
+    return emplace(value.first, value.second);
+  }
+
+  bool erase(const Key& key)
+  {
+    return with_shard(key, [&key](tree_type& tree) { return tree.erase(key); });
+  }
+
+  std::optional<Data> find(const Key& key)
+  {
+    return with_shard(key, [&key](tree_type& tree) -> std::optional<Data>
+    {
+      auto it = tree.find(key);
+
+      if (it == tree.end())
+      {
+        return std::nullopt;
+      }
+
+      return it->second;
+    });
+  }
+
+  bool contains(const Key& key)
+  {
+    return with_shard(key, [&key](tree_type& tree) { return tree.contains(key); });
+  }
+
+  std::optional<value_type> lower_bound(const Key& key)
+  {
+    std::shared_lock boundaries_lock{ boundaries_mutex_ };
+
+    for (std::size_t j = shard_for(key); j < shard_count_; j++)
+    {
+      std::lock_guard shard_lock{ shards_[j].mutex };
+      tree_type& tree = shards_[j].tree;
+      auto it = tree.lower_bound(key);
+
+      if (it != tree.end())
+      {
+        return *it;
+      }
+    }
+
+    return std::nullopt;
+  }
+
+  // Visits the elements in key order, locking one shard at a time.
+  template<class Function>
+  void for_each(Function&& function)
+  {
+    std::shared_lock boundaries_lock{ boundaries_mutex_ };
+
+    for (std::size_t j = 0; j < shard_count_; j++)
+    {
+      std::lock_guard shard_lock{ shards_[j].mutex };
+
+      for (auto& [key, value] : shards_[j].tree)
+      {
+        function(key, value);
+      }
+    }
+  }
+
+  // Moves the boundaries to the element quantiles. Each shard splits off the ranges that now belong to other shards
+  // and those are merged into their new shards, so only elements that change shards move. Shards with equal
+  // allocators, such as the default std::allocator, relink them. With slab_allocator, each shard has a pool of its
+  // own (select_on_container_copy_construction starts a fresh one), so every moving element is copied into the target
+  // shard's pool and its old node is freed.
+  void rebalance()
+  {
+    std::unique_lock boundaries_lock{ boundaries_mutex_ };
+    std::size_t total = 0;
+
+    for (std::size_t j = 0; j < shard_count_; j++)
+    {
+      total += shards_[j].tree.size();
+    }
+
+    std::vector<Key> boundaries;
+
+    if (total >= shard_count_)
+    {
+      boundaries.reserve(shard_count_ - 1);
+      std::size_t index = 0;
+
+      for (std::size_t j = 0; j < shard_count_ && boundaries.size() + 1 < shard_count_; j++)
+      {
+        for (auto it = shards_[j].tree.cbegin(); it != shards_[j].tree.cend() && boundaries.size() + 1 < shard_count_; ++it, ++index)
+        {
+          if (index == (boundaries.size() + 1) * total / shard_count_)
+          {
+            boundaries.push_back(it->first);
+          }
+        }
+      }
+    }
+
+    std::vector<std::pair<std::size_t, tree_type>> moving;
+
+    for (std::size_t j = 0; j < shard_count_; j++)
+    {
+      tree_type& tree = shards_[j].tree;
+      tree_type kept;
+
+      for (std::size_t k = boundaries.size(); k > 0 && !tree.empty(); k--)
+      {
+        tree_type part = tree.split(boundaries[k - 1]);
+
+        if (k == j)
+        {
+          kept = std::move(part);
+        }
+        else if (!part.empty())
+        {
+          moving.emplace_back(k, std::move(part));
+        }
+      }
+
+      if (j != 0)
+      {
+        if (!tree.empty())
+        {
+          moving.emplace_back(0, std::move(tree));
+        }
+
+        tree.merge(kept);
+      }
+    }
+
+    for (auto& [target, part] : moving)
+    {
+      shards_[target].tree.merge(part);
+    }
+
+    boundaries_ = std::move(boundaries);
+  }
+
+  void clear()
+  {
+    std::unique_lock boundaries_lock{ boundaries_mutex_ };
+
+    for (std::size_t j = 0; j < shard_count_; j++)
+    {
+      shards_[j].tree.clear();
+    }
+  }
+
+  std::size_t size() const
+  {
+    std::shared_lock boundaries_lock{ boundaries_mutex_ };
+    std::size_t result = 0;
+
+    for (std::size_t j = 0; j < shard_count_; j++)
+    {
+      std::lock_guard shard_lock{ shards_[j].mutex };
+      result += shards_[j].tree.size();
+    }
+
+    return result;
+  }
+
+  bool empty() const
+  {
+    return size() == 0;
+  }
+
+  std::size_t shard_count() const noexcept
+  {
+    return shard_count_;
+  }
+
+  std::size_t shard_size(std::size_t index) const
+  {
+    std::shared_lock boundaries_lock{ boundaries_mutex_ };
+    std::lock_guard shard_lock{ shards_[index].mutex };
+
+    return shards_[index].tree.size();
+  }
+};
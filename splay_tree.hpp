@@ -4,13 +4,38 @@
 #include <stdexcept>
 #include <utility>
 #include <ranges>
-#include <queue>
 #include <iterator>
 #include <initializer_list>
 #include <algorithm>
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <bit>
+#include <type_traits>
+#include <limits>
+#include <optional>
+#include <span>
+#include <numeric>
+#include <array>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
 
 namespace internal
 {
+  inline void prefetch(const void* address) noexcept
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+    static_cast<void>(address);
+#endif
+  }
+
   template<class Allocator, class NewType>
   concept RebindPresence = requires
   {
@@ -46,794 +71,3019 @@ namespace internal
   }
 }
 
-template<class Key, class Data, class Comparator = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, Data>>>
-class splay_tree
+namespace internal
 {
-  friend class iterator;
-  friend class const_iterator;
-  class data_node;
-
-public:
-  using key_type = Key;
-  using mapped_type = Data;
-  using value_type = std::pair<const Key, Data>;
-  using size_type = std::size_t;
-  using difference_type = std::ptrdiff_t;
-  using key_compare = Comparator;
-  using allocator_type = Allocator;
-  using reference = value_type&;
-  using const_reference = const value_type&;
-  using pointer = typename std::allocator_traits<Allocator>::pointer;
-  using const_pointer = typename std::allocator_traits<Allocator>::const_pointer;
-
-private:
-  class tree_node
+  // Hands out fixed-size slots from geometrically growing chunks and recycles freed slots through an intrusive free list.
+  class slab_pool
   {
-    friend class splay_tree<Key, Data, Comparator, Allocator>;
-
-  private:
-    tree_node* parent_;
-    tree_node* left_;
-    tree_node* right_;
-
-  public:
-    tree_node(const tree_node&) = default;
-    tree_node(tree_node&&) noexcept = default;
-    tree_node& operator=(const tree_node&) = default;
-    tree_node& operator=(tree_node&&) noexcept = default;
-    ~tree_node() noexcept = default;
-
-    tree_node() noexcept : parent_{}, left_{}, right_{}
-    {}
-
-    value_type& get_pair() noexcept
+    struct free_slot
     {
-      return static_cast<data_node*>(this)->get_pair();
-    }
-  };
-
-  class data_node : public tree_node
-  {
-    friend class splay_tree<Key, Data, Comparator, Allocator>;
+      free_slot* next;
+    };
 
-  private:
-    value_type key_data_pair_;
+    std::vector<std::pair<std::byte*, std::size_t>> chunks_;
+    free_slot* free_list_ = {};
+    std::byte* chunk_cursor_ = {};
+    std::size_t chunk_left_ = {};
+    std::size_t free_count_ = {};
+    std::size_t slot_alignment_;
+    std::size_t slot_size_;
+    std::size_t max_chunk_size_;
+    std::size_t next_chunk_size_;
 
   public:
-    data_node(const data_node&) = delete;
-    data_node(data_node&&) noexcept = default;
-    data_node& operator=(const data_node&) = delete;
-    data_node& operator=(data_node&&) noexcept = default;
-    ~data_node() noexcept = default;
-
-    data_node() noexcept : key_data_pair_{}
+    slab_pool(std::size_t size, std::size_t alignment, std::size_t max_chunk_size) noexcept
+      : slot_alignment_{ slot_alignment(alignment) }, slot_size_{ slot_size(size, alignment) },
+      max_chunk_size_{ max_chunk_size }, next_chunk_size_{ std::min<std::size_t>(64, max_chunk_size) }
     {}
 
-    template<class Pair>
-    explicit data_node(Pair&& data) noexcept : key_data_pair_{ std::forward<Pair>(data) }
-    {}
+    slab_pool(const slab_pool&) = delete;
+    slab_pool& operator=(const slab_pool&) = delete;
 
-    value_type& get_pair() noexcept
+    ~slab_pool() noexcept
     {
-      return key_data_pair_;
+      for (auto [chunk, chunk_size] : chunks_)
+      {
+        ::operator delete(chunk, chunk_size * slot_size_, std::align_val_t{ slot_alignment_ });
+      }
     }
-  };
-
-public:
-  class iterator
-  {
-    friend class splay_tree<Key, Data, Comparator, Allocator>;
-
-  public:
-    using value_type = std::pair<const Key, Data>;
-    using reference = value_type&;
-    using pointer = value_type*;
-    using iterator_category = std::bidirectional_iterator_tag;
-    using difference_type = std::ptrdiff_t;
-
-  protected:
-    tree_node* node_;
-
-  public:
-    iterator() noexcept = default;
-    iterator(const iterator&) noexcept = default;
-    iterator(iterator&&) noexcept = default;
-    iterator& operator=(const iterator&) noexcept = default;
-    iterator& operator=(iterator&&) noexcept = default;
-    ~iterator() noexcept = default;
 
-    explicit iterator(tree_node* node) noexcept : node_{ node }
-    {}
+    static std::size_t slot_alignment(std::size_t alignment) noexcept
+    {
+      return std::max(alignment, alignof(free_slot));
+    }
 
-    reference operator*() const noexcept
+    static std::size_t slot_size(std::size_t size, std::size_t alignment) noexcept
     {
-      return node_->get_pair();
+      std::size_t slot_alignment = slab_pool::slot_alignment(alignment);
+
+      return (std::max(size, sizeof(free_slot)) + slot_alignment - 1) / slot_alignment * slot_alignment;
     }
 
-    pointer operator->() const noexcept
+    bool serves(std::size_t size, std::size_t alignment) const noexcept
     {
-      return &node_->get_pair();
+      return slot_size_ == slot_size(size, alignment) && slot_alignment_ == slot_alignment(alignment);
     }
 
-    iterator& operator++() noexcept
+    void* allocate()
     {
-      if (node_->right_ == nullptr)
+      if (free_list_ != nullptr)
       {
-        tree_node* parent_node;
-
-        while ((parent_node = node_->parent_) != nullptr && node_ == parent_node->right_)
-        {
-          node_ = parent_node;
-        }
-
-        node_ = parent_node;
+        free_slot* result = free_list_;
+        free_list_ = free_list_->next;
+        --free_count_;
+        return result;
       }
-      else
+
+      if (chunk_left_ == 0)
       {
-        node_ = find_sub_tree_min(node_->right_);
+        add_chunk(next_chunk_size_);
+        next_chunk_size_ = std::min(next_chunk_size_ * 2, max_chunk_size_);
       }
 
-      return *this;
+      --chunk_left_;
+      return std::exchange(chunk_cursor_, chunk_cursor_ + slot_size_);
     }
 
-    iterator operator++(int) noexcept
+    void deallocate(void* ptr) noexcept
     {
-      iterator temp = *this;
-      ++*this;
-      return temp;
+      free_list_ = ::new (ptr) free_slot{ free_list_ };
+      ++free_count_;
     }
 
-    iterator& operator--() noexcept
+    void reserve(std::size_t count)
     {
-      if (node_->left_ == nullptr)
+      std::size_t available = chunk_left_ + free_count_;
+
+      if (available < count)
       {
-        tree_node* parent_node;
+        add_chunk(count - available);
+      }
+    }
 
-        while ((parent_node = node_->parent_) != nullptr && node_ == parent_node->left_)
-        {
-          node_ = parent_node;
-        }
+  private:
+    void add_chunk(std::size_t chunk_size)
+    {
+      chunks_.reserve(chunks_.size() + 1);
+      std::byte* chunk = static_cast<std::byte*>(::operator new(chunk_size * slot_size_, std::align_val_t{ slot_alignment_ }));
+      chunks_.emplace_back(chunk, chunk_size);
 
-        node_ = parent_node;
-      }
-      else
+      for (; chunk_left_ != 0; --chunk_left_)
       {
-        node_ = find_sub_tree_max(node_->left_);
+        deallocate(std::exchange(chunk_cursor_, chunk_cursor_ + slot_size_));
       }
 
-      return *this;
+      chunk_cursor_ = chunk;
+      chunk_left_ = chunk_size;
     }
+  };
 
-    iterator operator--(int) noexcept
-    {
-      iterator temp = *this;
-      --*this;
-      return temp;
-    }
+  // The pools behind one slab_allocator and all of its copies and rebinds, one pool per slot geometry.
+  class slab_pool_set
+  {
+    std::vector<std::unique_ptr<slab_pool>> pools_;
+    std::size_t max_chunk_size_;
 
-    bool operator==(const iterator& obj) const noexcept
-    {
-      return node_ == obj.node_;
-    }
+  public:
+    explicit slab_pool_set(std::size_t max_chunk_size) noexcept : max_chunk_size_{ max_chunk_size }
+    {}
 
-    bool operator!=(const iterator& obj) const noexcept
+    slab_pool& get(std::size_t size, std::size_t alignment)
     {
-      return node_ != obj.node_;
+      for (auto& pool : pools_)
+      {
+        if (pool->serves(size, alignment))
+        {
+          return *pool;
+        }
+      }
+
+      return *pools_.emplace_back(std::make_unique<slab_pool>(size, alignment, max_chunk_size_));
     }
   };
+}
 
-  class const_iterator
-  {
-    friend class splay_tree<Key, Data, Comparator, Allocator>;
+// Copies and rebinds of a slab_allocator share its pools and compare equal, so trees constructed from the same
+// allocator object can exchange nodes (merge, join, split) without copying them. The pools are not synchronized:
+// trees sharing them must not be modified concurrently. select_on_container_copy_construction starts a fresh pool.
+template<class T, std::size_t MaxChunkSize = 65536>
+class slab_allocator
+{
+  template<class U, std::size_t OtherMaxChunkSize>
+  friend class slab_allocator;
 
-  private:
-    iterator it_;
+  std::shared_ptr<internal::slab_pool_set> pools_;
+  internal::slab_pool* pool_ = {};
 
-  public:
-    using value_type = const std::pair<const Key, Data>;
-    using reference = const value_type&;
-    using pointer = const value_type*;
-    using iterator_category = std::bidirectional_iterator_tag;
-    using difference_type = std::ptrdiff_t;
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using propagate_on_container_copy_assignment = std::false_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  using is_always_equal = std::false_type;
 
-    const_iterator() noexcept = default;
-    const_iterator(const const_iterator&) noexcept = default;
-    const_iterator(const_iterator&&) noexcept = default;
-    const_iterator& operator=(const const_iterator&) noexcept = default;
-    const_iterator& operator=(const_iterator&&) noexcept = default;
-    ~const_iterator() noexcept = default;
+  template<class U>
+  struct rebind
+  {
+    using other = slab_allocator<U, MaxChunkSize>;
+  };
 
-    explicit const_iterator(tree_node* node) : it_{ node }
-    {}
+  slab_allocator() : pools_{ std::make_shared<internal::slab_pool_set>(MaxChunkSize) }
+  {}
 
-    reference operator*() const noexcept
-    {
-      return it_.node_->get_pair();
-    }
+  // Moving copies the pool handle, so a moved-from allocator keeps serving and freeing its pool.
+  slab_allocator(const slab_allocator&) noexcept = default;
+  slab_allocator& operator=(const slab_allocator&) noexcept = default;
+  ~slab_allocator() noexcept = default;
 
-    pointer operator->() const noexcept
-    {
-      return &it_.node_->get_pair();
-    }
+  template<class U>
+  slab_allocator(const slab_allocator<U, MaxChunkSize>& obj) noexcept : pools_{ obj.pools_ }
+  {}
 
-    const_iterator& operator++() noexcept
+  T* allocate(std::size_t count)
+  {
+    if (count != 1)
     {
-      ++it_;
-      return *this;
+      return std::allocator<T>{}.allocate(count);
     }
 
-    const_iterator operator++(int) noexcept
-    {
-      const_iterator temp = *this;
-      ++it_;
-      return temp;
-    }
+    return static_cast<T*>(pool().allocate());
+  }
 
-    const_iterator& operator--() noexcept
+  void deallocate(T* ptr, std::size_t count) noexcept
+  {
+    if (count != 1)
     {
-      --it_;
-      return *this;
+      std::allocator<T>{}.deallocate(ptr, count);
     }
-
-    const_iterator operator--(int) noexcept
+    else
     {
-      const_iterator temp = *this;
-      --it_;
-      return temp;
+      // An equal allocator allocated the slot, so the pool for T already exists and the lookup does not allocate.
+      pool().deallocate(ptr);
     }
+  }
 
-    bool operator==(const const_iterator& obj) const noexcept
+  void reserve(std::size_t count)
+  {
+    pool().reserve(count);
+  }
+
+  slab_allocator select_on_container_copy_construction() const
+  {
+    return {};
+  }
+
+  template<class U>
+  bool operator==(const slab_allocator<U, MaxChunkSize>& obj) const noexcept
+  {
+    return pools_ == obj.pools_;
+  }
+
+  template<class U>
+  bool operator!=(const slab_allocator<U, MaxChunkSize>& obj) const noexcept
+  {
+    return pools_ != obj.pools_;
+  }
+
+private:
+  internal::slab_pool& pool()
+  {
+    if (pool_ == nullptr)
     {
-      return it_.node_ == obj.it_.node_;
+      pool_ = &pools_->get(sizeof(T), alignof(T));
     }
 
-    bool operator!=(const const_iterator& obj) const noexcept
+    return *pool_;
+  }
+};
+
+struct rebalanced_copy_t
+{
+  explicit rebalanced_copy_t() = default;
+};
+
+inline constexpr rebalanced_copy_t rebalanced_copy{};
+
+struct sorted_unique_t
+{
+  explicit sorted_unique_t() = default;
+};
+
+inline constexpr sorted_unique_t sorted_unique{};
+
+namespace splay_policy
+{
+  // Restructures the search path while descending (Sleator-Tarjan top-down splaying).
+  struct top_down
+  {
+    static constexpr bool is_top_down = true;
+    static constexpr bool is_semi_splay = false;
+  };
+
+  // Descends with find_internal and then rotates the found node up through its parent_ links.
+  // The bottom-up policies below decide per lookup whether the accessed node is splayed at all.
+  struct bottom_up
+  {
+    static constexpr bool is_top_down = false;
+    static constexpr bool is_semi_splay = false;
+
+    bool should_splay(std::size_t, std::size_t, bool) noexcept
     {
-      return it_.node_ != obj.it_.node_;
+      return true;
     }
   };
 
-  struct temp_pointer
+  // Rotates the parent instead of the node on zig-zig steps, roughly halving the depth of the path.
+  struct semi_splay : bottom_up
   {
-    data_node* ptr = {};
-    internal::node_allocator_t<Allocator, data_node>& node_allocator;
+    static constexpr bool is_semi_splay = true;
+  };
 
-    ~temp_pointer()
+  // Splays only when the node was found deeper than Numerator / Denominator * log2(size).
+  template<std::size_t Numerator = 2, std::size_t Denominator = 1>
+  struct depth_threshold : bottom_up
+  {
+    bool should_splay(std::size_t depth, std::size_t tree_size, bool) noexcept
     {
-	    if (ptr != nullptr)
-	    {
-        node_allocator.deallocate(ptr, 1);
-	    }
+      return depth * Denominator > Numerator * static_cast<std::size_t>(std::bit_width(tree_size));
     }
   };
 
-private:
-  internal::node_allocator_t<Allocator, data_node> node_allocator_;
-  Comparator comparator_;
-  mutable tree_node end_ = {};
-  tree_node* root_ = {};
-  tree_node* begin_ = &end_;
-  std::size_t tree_size_ = {};
-
-private:
-  template<class T>
-  tree_node* allocate_and_construct_node(T&& data)
+  // Splays on every K-th lookup.
+  template<std::size_t K>
+  struct every_kth : bottom_up
   {
-    data_node* result = node_allocator_.allocate(1);
-    temp_pointer temp_ptr = { .ptr = result, .node_allocator = node_allocator_ };
+    static_assert(K != 0);
 
-    std::construct_at(result, std::forward<T>(data));
-    temp_ptr.ptr = {};
+    std::size_t counter = 0;
 
-    return result;
-  }
+    bool should_splay(std::size_t, std::size_t, bool) noexcept
+    {
+      if (++counter == K)
+      {
+        counter = 0;
+        return true;
+      }
 
-  template<class... Args>
-  tree_node* allocate_and_construct_node_emplace(const Key& key, Args&&... args)
+      return false;
+    }
+  };
+
+  // Splays with probability Numerator / Denominator.
+  template<std::size_t Numerator, std::size_t Denominator>
+  struct probabilistic : bottom_up
   {
-    data_node* result = node_allocator_.allocate(1);
-    temp_pointer temp_ptr = { .ptr = result, .node_allocator = node_allocator_ };
+    static_assert(Numerator <= Denominator && Denominator != 0);
 
-    std::construct_at(std::addressof(result->get_pair().second), std::forward<Args>(args)...);
-    std::construct_at(const_cast<Key*>(std::addressof(result->get_pair().first)), key);
-    temp_ptr.ptr = {};
+    std::uint64_t state = 0x9E3779B97F4A7C15ull;
 
-    result->right_ = {};
-    result->left_ = {};
-    result->parent_ = {};
+    bool should_splay(std::size_t, std::size_t, bool) noexcept
+    {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
 
-    return result;
-  }
+      return state % Denominator < Numerator;
+    }
+  };
 
-  void insert_node(tree_node* node_to_insert) noexcept
+  // Leaves the tree untouched when a lookup misses and defers to Base otherwise.
+  template<class Base = bottom_up>
+  struct splay_on_hit : Base
   {
-    auto [target_node, prev_node] = find_internal(node_to_insert->get_pair().first);
+    static_assert(!Base::is_top_down);
 
-    if (target_node == nullptr && prev_node == nullptr)
+    bool should_splay(std::size_t depth, std::size_t tree_size, bool found) noexcept
     {
-      root_ = node_to_insert;
-      node_to_insert->right_ = &end_;
-      end_.parent_ = node_to_insert;
-      begin_ = node_to_insert;
-      ++tree_size_;
-    }
-    else if (target_node && target_node != &end_)
-    {
-      splay(target_node);
-      std::destroy_at(static_cast<data_node*>(node_to_insert));
-      node_allocator_.deallocate(static_cast<data_node*>(node_to_insert), 1);
+      return found && Base::should_splay(depth, tree_size, found);
     }
-    else
-    {
-      tree_node** where_to_place_ptr = comparator_(node_to_insert->get_pair().first, prev_node->get_pair().first) ?
-        &prev_node->left_ : &prev_node->right_;
+  };
+}
 
-      if (*where_to_place_ptr == &end_)
-      {
-        node_to_insert->right_ = &end_;
-        end_.parent_ = node_to_insert;
-      }
+namespace splay_augmentation
+{
+  struct none
+  {
+    static constexpr bool maintains_size = false;
+    static constexpr bool is_lazy = false;
 
-      if (comparator_(node_to_insert->get_pair().first, begin_->get_pair().first))
-      {
-        begin_ = node_to_insert;
-      }
+    struct node_data
+    {};
 
-      node_to_insert->parent_ = prev_node;
-      *where_to_place_ptr = node_to_insert;
-      splay(node_to_insert);
-      ++tree_size_;
-    }
-  }
+    template<class Pair>
+    static void update(node_data&, const Pair&, const node_data&, const node_data&) noexcept
+    {}
+  };
 
-  std::pair<tree_node*, tree_node*> find_internal(const Key& key) noexcept
+  // Keeps the size of every subtree, enabling nth(), rank(), count_range() and distance().
+  struct order_statistics
   {
-    tree_node* current_node = root_, * prev_node = {};
+    static constexpr bool maintains_size = true;
+    static constexpr bool is_lazy = false;
 
-    while (current_node && current_node != &end_)
+    struct node_data
     {
-      prev_node = current_node;
+      std::size_t size = 0;
+    };
 
-      if (comparator_(key, current_node->get_pair().first))
-      {
-        current_node = current_node->left_;
-      }
-      else if (comparator_(current_node->get_pair().first, key))
-      {
-        current_node = current_node->right_;
-      }
-      else
-      {
-        break;
-      }
+    template<class Pair>
+    static void update(node_data& node, const Pair&, const node_data& left, const node_data& right) noexcept
+    {
+      node.size = left.size + right.size + 1;
     }
+  };
 
-    return { current_node, prev_node };
-  }
-
-  void erase_internal(tree_node* target_node) noexcept
+  // Keeps subtree sizes and the Monoid fold of the mapped values of every subtree, enabling aggregate(low, high).
+  template<class Monoid>
+  struct aggregate
   {
-    splay(target_node);
+    using monoid_type = Monoid;
+    using value_type = typename Monoid::value_type;
 
-    tree_node* left_sub_tree = target_node->left_;
-    tree_node* right_sub_tree = target_node->right_;
+    static constexpr bool maintains_size = true;
+    static constexpr bool is_lazy = false;
 
-    if (left_sub_tree == nullptr && right_sub_tree == nullptr)
-    {
-      tree_size_ = 0;
-      begin_ = &end_;
-      root_ = nullptr;
-    }
-    else if (left_sub_tree == nullptr)
+    struct node_data
     {
-      begin_ = find_sub_tree_min(right_sub_tree);
-      splay(begin_);
-      begin_->left_ = nullptr;
-    }
-    else if (right_sub_tree == nullptr)
+      std::size_t size = 0;
+      value_type value = Monoid::identity();
+    };
+
+    template<class Pair>
+    static value_type lift(const Pair& pair)
     {
-      tree_node* new_root = find_sub_tree_max(left_sub_tree);
-      splay(new_root);
-      new_root->right_ = &end_;
-      end_.parent_ = new_root;
+      return static_cast<value_type>(pair.second);
     }
-    else
+
+    template<class Pair>
+    static void update(node_data& node, const Pair& pair, const node_data& left, const node_data& right) noexcept
     {
-      tree_node* new_root = find_sub_tree_max(left_sub_tree);
-      splay(new_root);
-      new_root->right_ = right_sub_tree;
-      right_sub_tree->parent_ = new_root;
+      node.size = left.size + right.size + 1;
+      node.value = Monoid::combine(Monoid::combine(left.value, lift(pair)), right.value);
     }
+  };
 
-    std::destroy_at(static_cast<data_node*>(target_node));
-    node_allocator_.deallocate(static_cast<data_node*>(target_node), 1);
-    --tree_size_;
-  }
-
-  static tree_node* find_sub_tree_min(tree_node* obj) noexcept
-  {
-    tree_node* current_node = obj;
-    for (; current_node->left_ != nullptr; current_node = current_node->left_);
-
-    return current_node;
-  }
-
-  static tree_node* find_sub_tree_max(tree_node* obj) noexcept
+  // Like aggregate, but additionally lets apply_range(low, high, tag) update a whole key range at once.
+  // The tag is applied to the node it is stored in and pushed down to the children on the next descent.
+  template<class Monoid, class Action>
+  struct lazy_aggregate
   {
-    tree_node* current_node = obj;
-    for (; current_node->right_ != nullptr; current_node = current_node->right_);
+    using monoid_type = Monoid;
+    using value_type = typename Monoid::value_type;
+    using tag_type = typename Action::tag_type;
 
-    return current_node;
-  }
+    static constexpr bool maintains_size = true;
+    static constexpr bool is_lazy = true;
 
-  void zig(tree_node* target_node) noexcept
-  {
-    root_ = target_node;
-    tree_node* target_node_parent = target_node->parent_;
-    tree_node* target_node_right_child = target_node->right_;
+    struct node_data
+    {
+      std::size_t size = 0;
+      value_type value = Monoid::identity();
+      tag_type tag = Action::identity();
+    };
 
-    target_node->parent_ = nullptr;
-    target_node->right_ = target_node_parent;
-    target_node_parent->parent_ = target_node;
-    target_node_parent->left_ = target_node_right_child;
+    template<class Pair>
+    static value_type lift(const Pair& pair)
+    {
+      return static_cast<value_type>(pair.second);
+    }
 
-    if (target_node_right_child)
+    template<class Pair>
+    static void update(node_data& node, const Pair& pair, const node_data& left, const node_data& right) noexcept
     {
-      target_node_right_child->parent_ = target_node_parent;
+      node.size = left.size + right.size + 1;
+      node.value = Monoid::combine(Monoid::combine(left.value, lift(pair)), right.value);
     }
-  }
 
-  void zag(tree_node* target_node) noexcept
-  {
-    root_ = target_node;
-    tree_node* target_node_parent = target_node->parent_;
-    tree_node* target_node_left_child = target_node->left_;
+    template<class Pair>
+    static void apply(node_data& node, Pair& pair, const tag_type& tag) noexcept
+    {
+      Action::apply(tag, pair.second);
+      Action::template apply_aggregate<Monoid>(tag, node.value, node.size);
+      node.tag = Action::compose(tag, node.tag);
+    }
 
-    target_node->parent_ = nullptr;
-    target_node->left_ = target_node_parent;
-    target_node_parent->parent_ = target_node;
-    target_node_parent->right_ = target_node_left_child;
+    static bool has_pending(const node_data& node) noexcept
+    {
+      return !Action::is_identity(node.tag);
+    }
 
-    if (target_node_left_child)
+    static void clear_pending(node_data& node) noexcept
     {
-      target_node_left_child->parent_ = target_node_parent;
+      node.tag = Action::identity();
     }
-  }
+  };
+}
 
-  void zig_zig(tree_node* target_node_parent) noexcept
+namespace splay_monoid
+{
+  template<class T>
+  struct sum
   {
-    tree_node* target_node = target_node_parent->left_;
-    tree_node* target_node_parent_right_child = target_node_parent->right_;
-    tree_node* sub_tree_root = target_node_parent->parent_;
-    tree_node* grandparent = sub_tree_root->parent_;
-
-    target_node_parent->parent_ = target_node;
+    using value_type = T;
 
-    if (target_node_parent_right_child)
+    static value_type identity() noexcept
     {
-      target_node_parent_right_child->parent_ = sub_tree_root;
+      return value_type{};
     }
 
-    target_node_parent->left_ = target_node->right_;
-
-    if (target_node->right_)
+    static value_type combine(const value_type& lhs, const value_type& rhs) noexcept
     {
-      target_node->right_->parent_ = target_node_parent;
+      return lhs + rhs;
     }
+  };
 
-    target_node->right_ = target_node_parent;
-
-    target_node->parent_ = sub_tree_root->parent_;
-    sub_tree_root->parent_ = target_node_parent;
-
-    sub_tree_root->left_ = target_node_parent_right_child;
-    target_node_parent->right_ = sub_tree_root;
+  template<class T>
+  struct min
+  {
+    using value_type = T;
 
-    if (grandparent)
+    static value_type identity() noexcept
     {
-      if (grandparent->left_ == sub_tree_root) grandparent->left_ = target_node;
-      else grandparent->right_ = target_node;
+      return std::numeric_limits<value_type>::max();
     }
-    else
+
+    static value_type combine(const value_type& lhs, const value_type& rhs) noexcept
     {
-      root_ = target_node;
+      return rhs < lhs ? rhs : lhs;
     }
-  }
+  };
 
-  void zag_zag(tree_node* target_node_parent) noexcept
+  template<class T>
+  struct max
   {
-    tree_node* target_node = target_node_parent->right_;
-    tree_node* target_node_parent_left_child = target_node_parent->left_;
-    tree_node* sub_tree_root = target_node_parent->parent_;
-    tree_node* grandparent = sub_tree_root->parent_;
-
-    target_node_parent->parent_ = target_node;
+    using value_type = T;
 
-    if (target_node_parent_left_child)
+    static value_type identity() noexcept
     {
-      target_node_parent_left_child->parent_ = sub_tree_root;
+      return std::numeric_limits<value_type>::lowest();
     }
 
-    target_node_parent->right_ = target_node->left_;
-
-    if (target_node->left_)
+    static value_type combine(const value_type& lhs, const value_type& rhs) noexcept
     {
-      target_node->left_->parent_ = target_node_parent;
+      return lhs < rhs ? rhs : lhs;
     }
+  };
 
-    target_node->left_ = target_node_parent;
-
-    target_node->parent_ = sub_tree_root->parent_;
-    sub_tree_root->parent_ = target_node_parent;
+  template<class Monoid>
+  inline constexpr bool is_sum = std::is_same_v<Monoid, sum<typename Monoid::value_type>>;
+}
 
-    sub_tree_root->right_ = target_node_parent_left_child;
-    target_node_parent->left_ = sub_tree_root;
+namespace splay_action
+{
+  // Adds the tag to every mapped value in the range. Works with the sum, min and max monoids.
+  template<class T>
+  struct add
+  {
+    using tag_type = T;
 
-    if (grandparent)
+    static tag_type identity() noexcept
     {
-      if (grandparent->left_ == sub_tree_root) grandparent->left_ = target_node;
-      else grandparent->right_ = target_node;
+      return tag_type{};
     }
-    else
+
+    static bool is_identity(const tag_type& tag) noexcept
     {
-      root_ = target_node;
+      return tag == tag_type{};
     }
-  }
 
-  void zig_zag(tree_node* target_node_parent) noexcept
-  {
-    tree_node* target_node = target_node_parent->left_;
-    tree_node* sub_tree_root = target_node_parent->parent_;
-    tree_node* grandparent = sub_tree_root->parent_;
+    static tag_type compose(const tag_type& newer, const tag_type& older) noexcept
+    {
+      return newer + older;
+    }
 
-    target_node->parent_ = sub_tree_root->parent_;
+    template<class Data>
+    static void apply(const tag_type& tag, Data& value) noexcept
+    {
+      value += tag;
+    }
 
-    if (target_node->left_)
+    template<class Monoid>
+    static void apply_aggregate(const tag_type& tag, typename Monoid::value_type& value, std::size_t size) noexcept
     {
-      target_node->left_->parent_ = sub_tree_root;
+      if constexpr (splay_monoid::is_sum<Monoid>)
+      {
+        value += tag * static_cast<typename Monoid::value_type>(size);
+      }
+      else
+      {
+        value += tag;
+      }
     }
+  };
 
-    sub_tree_root->right_ = target_node->left_;
-    target_node->left_ = sub_tree_root;
+  // Overwrites every mapped value in the range with the tag. Works with the sum, min and max monoids.
+  template<class T>
+  struct assign
+  {
+    using tag_type = std::optional<T>;
 
-    if (target_node->right_)
+    static tag_type identity() noexcept
     {
-      target_node->right_->parent_ = target_node_parent;
+      return std::nullopt;
     }
 
-    target_node_parent->left_ = target_node->right_;
-    target_node->right_ = target_node_parent;
-    target_node_parent->parent_ = target_node;
-    sub_tree_root->parent_ = target_node;
+    static bool is_identity(const tag_type& tag) noexcept
+    {
+      return !tag.has_value();
+    }
 
-    if (grandparent)
+    static tag_type compose(const tag_type& newer, const tag_type& older) noexcept
     {
-      if (grandparent->left_ == sub_tree_root) grandparent->left_ = target_node;
-      else grandparent->right_ = target_node;
+      return newer ? newer : older;
     }
-    else
+
+    template<class Data>
+    static void apply(const tag_type& tag, Data& value) noexcept
     {
-      root_ = target_node;
+      value = *tag;
     }
-  }
 
-  void zag_zig(tree_node* target_node_parent) noexcept
-  {
-    tree_node* target_node = target_node_parent->right_;
-    tree_node* sub_tree_root = target_node_parent->parent_;
+    template<class Monoid>
+    static void apply_aggregate(const tag_type& tag, typename Monoid::value_type& value, std::size_t size) noexcept
+    {
+      if constexpr (splay_monoid::is_sum<Monoid>)
+      {
+        value = static_cast<typename Monoid::value_type>(*tag) * static_cast<typename Monoid::value_type>(size);
+      }
+      else
+      {
+        value = static_cast<typename Monoid::value_type>(*tag);
+      }
+    }
+  };
+}
+
+namespace splay_stats
+{
+  enum class rotation
+  {
+    zig,
+    zag,
+    zig_zig,
+    zag_zag,
+    zig_zag,
+    zag_zig
+  };
+
+  // Collects nothing; every hook is an empty inline function, so the default tree carries no instrumentation.
+  struct none
+  {
+    static constexpr bool enabled = false;
+
+    void count_rotation(rotation) noexcept
+    {}
+
+    void count_depth(std::size_t) noexcept
+    {}
+
+    void count_comparison() noexcept
+    {}
+
+    void count_allocation() noexcept
+    {}
+
+    void count_skipped_splay() noexcept
+    {}
+  };
+
+  // Counts restructuring work. Top-down splaying reports each rotate-and-link step as zig_zig or zag_zag and each
+  // plain link as zig or zag, so a zig-zag step shows up as one zig and one zag. Depths past the last histogram bucket
+  // are added to it.
+  template<std::size_t DepthBuckets = 64>
+  struct counters
+  {
+    static_assert(DepthBuckets != 0);
+    static constexpr bool enabled = true;
+
+    std::array<std::size_t, 6> rotations{};
+    std::array<std::size_t, DepthBuckets> depth_histogram{};
+    std::size_t comparisons = 0;
+    std::size_t allocations = 0;
+    std::size_t skipped_splays = 0;
+
+    void count_rotation(rotation kind) noexcept
+    {
+      ++rotations[static_cast<std::size_t>(kind)];
+    }
+
+    void count_depth(std::size_t depth) noexcept
+    {
+      ++depth_histogram[std::min(depth, DepthBuckets - 1)];
+    }
+
+    void count_comparison() noexcept
+    {
+      ++comparisons;
+    }
+
+    void count_allocation() noexcept
+    {
+      ++allocations;
+    }
+
+    void count_skipped_splay() noexcept
+    {
+      ++skipped_splays;
+    }
+
+    std::size_t rotation_count(rotation kind) const noexcept
+    {
+      return rotations[static_cast<std::size_t>(kind)];
+    }
+  };
+}
+
+// Lookups on a non-const tree splay the accessed node. The const lookups never rotate, but they only leave the tree
+// untouched, and so may run concurrently, when Augmentation is not lazy (descents push pending range tags) and Stats
+// is splay_stats::none (every comparison and descent is counted).
+template<class Key, class Data, class Comparator = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, Data>>,
+  class SplayPolicy = splay_policy::top_down, class Augmentation = splay_augmentation::none, class Stats = splay_stats::none>
+class splay_tree
+{
+  friend class iterator;
+  friend class const_iterator;
+  class data_node;
+
+public:
+  using key_type = Key;
+  using mapped_type = Data;
+  using value_type = std::pair<const Key, Data>;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using key_compare = Comparator;
+  using allocator_type = Allocator;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = typename std::allocator_traits<Allocator>::pointer;
+  using const_pointer = typename std::allocator_traits<Allocator>::const_pointer;
+
+private:
+  class tree_node
+  {
+    friend class splay_tree;
+
+  private:
+    tree_node* parent_;
+    tree_node* left_;
+    tree_node* right_;
+    [[no_unique_address]] typename Augmentation::node_data augmentation_;
+
+  public:
+    tree_node(const tree_node&) = default;
+    tree_node(tree_node&&) noexcept = default;
+    tree_node& operator=(const tree_node&) = default;
+    tree_node& operator=(tree_node&&) noexcept = default;
+    ~tree_node() noexcept = default;
+
+    tree_node() noexcept : parent_{}, left_{}, right_{}, augmentation_{}
+    {}
+
+    value_type& get_pair() noexcept
+    {
+      return static_cast<data_node*>(this)->get_pair();
+    }
+  };
+
+  class data_node : public tree_node
+  {
+    friend class splay_tree;
+
+  private:
+    value_type key_data_pair_;
+
+  public:
+    data_node(const data_node&) = delete;
+    data_node(data_node&&) noexcept = default;
+    data_node& operator=(const data_node&) = delete;
+    data_node& operator=(data_node&&) noexcept = default;
+    ~data_node() noexcept = default;
+
+    data_node() noexcept : key_data_pair_{}
+    {}
+
+    template<class Pair>
+    explicit data_node(Pair&& data) noexcept : key_data_pair_{ std::forward<Pair>(data) }
+    {}
+
+    value_type& get_pair() noexcept
+    {
+      return key_data_pair_;
+    }
+  };
+
+public:
+  class iterator
+  {
+    friend class splay_tree;
+
+  public:
+    using value_type = std::pair<const Key, Data>;
+    using reference = value_type&;
+    using pointer = value_type*;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+
+  protected:
+    tree_node* node_;
+
+  public:
+    iterator() noexcept = default;
+    iterator(const iterator&) noexcept = default;
+    iterator(iterator&&) noexcept = default;
+    iterator& operator=(const iterator&) noexcept = default;
+    iterator& operator=(iterator&&) noexcept = default;
+    ~iterator() noexcept = default;
+
+    explicit iterator(tree_node* node) noexcept : node_{ node }
+    {}
+
+    reference operator*() const noexcept
+    {
+      return node_->get_pair();
+    }
+
+    pointer operator->() const noexcept
+    {
+      return &node_->get_pair();
+    }
+
+    iterator& operator++() noexcept
+    {
+      if (node_->right_ == nullptr)
+      {
+        tree_node* parent_node;
+
+        while ((parent_node = node_->parent_) != nullptr && node_ == parent_node->right_)
+        {
+          node_ = parent_node;
+        }
+
+        node_ = parent_node;
+      }
+      else
+      {
+        push(node_);
+        node_ = find_sub_tree_min(node_->right_);
+      }
+
+      return *this;
+    }
+
+    iterator operator++(int) noexcept
+    {
+      iterator temp = *this;
+      ++*this;
+      return temp;
+    }
+
+    iterator& operator--() noexcept
+    {
+      if (node_->left_ == nullptr)
+      {
+        tree_node* parent_node;
+
+        while ((parent_node = node_->parent_) != nullptr && node_ == parent_node->left_)
+        {
+          node_ = parent_node;
+        }
+
+        node_ = parent_node;
+      }
+      else
+      {
+        push(node_);
+        node_ = find_sub_tree_max(node_->left_);
+      }
+
+      return *this;
+    }
+
+    iterator operator--(int) noexcept
+    {
+      iterator temp = *this;
+      --*this;
+      return temp;
+    }
+
+    bool operator==(const iterator& obj) const noexcept
+    {
+      return node_ == obj.node_;
+    }
+
+    bool operator!=(const iterator& obj) const noexcept
+    {
+      return node_ != obj.node_;
+    }
+  };
+
+  class const_iterator
+  {
+    friend class splay_tree;
+
+  private:
+    iterator it_;
+
+  public:
+    using value_type = const std::pair<const Key, Data>;
+    using reference = const value_type&;
+    using pointer = const value_type*;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+
+    const_iterator() noexcept = default;
+    const_iterator(const const_iterator&) noexcept = default;
+    const_iterator(const_iterator&&) noexcept = default;
+    const_iterator& operator=(const const_iterator&) noexcept = default;
+    const_iterator& operator=(const_iterator&&) noexcept = default;
+    ~const_iterator() noexcept = default;
+
+    explicit const_iterator(tree_node* node) : it_{ node }
+    {}
+
+    const_iterator(const iterator& it) noexcept : it_{ it }
+    {}
+
+    reference operator*() const noexcept
+    {
+      return it_.node_->get_pair();
+    }
+
+    pointer operator->() const noexcept
+    {
+      return &it_.node_->get_pair();
+    }
+
+    const_iterator& operator++() noexcept
+    {
+      ++it_;
+      return *this;
+    }
+
+    const_iterator operator++(int) noexcept
+    {
+      const_iterator temp = *this;
+      ++it_;
+      return temp;
+    }
+
+    const_iterator& operator--() noexcept
+    {
+      --it_;
+      return *this;
+    }
+
+    const_iterator operator--(int) noexcept
+    {
+      const_iterator temp = *this;
+      --it_;
+      return temp;
+    }
+
+    bool operator==(const const_iterator& obj) const noexcept
+    {
+      return it_.node_ == obj.it_.node_;
+    }
+
+    bool operator!=(const const_iterator& obj) const noexcept
+    {
+      return it_.node_ != obj.it_.node_;
+    }
+  };
+
+private:
+  using node_allocator_type = internal::node_allocator_t<Allocator, data_node>;
+
+  struct temp_pointer
+  {
+    data_node* ptr = {};
+    node_allocator_type& node_allocator;
+
+    ~temp_pointer()
+    {
+	    if (ptr != nullptr)
+	    {
+        node_allocator.deallocate(ptr, 1);
+	    }
+    }
+  };
+
+private:
+  node_allocator_type node_allocator_;
+  Comparator comparator_;
+  [[no_unique_address]] SplayPolicy splay_policy_;
+  [[no_unique_address]] mutable Stats stats_;
+  mutable tree_node end_ = {};
+  tree_node* root_ = {};
+  tree_node* begin_ = &end_;
+  tree_node* finger_ = {};
+  std::size_t tree_size_ = {};
+
+private:
+  bool compare(const Key& lhs, const Key& rhs) const
+  {
+    stats_.count_comparison();
+
+    return comparator_(lhs, rhs);
+  }
+
+  template<class... Args>
+  tree_node* allocate_and_construct_node_emplace(const Key& key, Args&&... args)
+  {
+    stats_.count_allocation();
+    data_node* result = node_allocator_.allocate(1);
+    temp_pointer temp_ptr = { .ptr = result, .node_allocator = node_allocator_ };
+
+    std::construct_at(std::addressof(result->get_pair().second), std::forward<Args>(args)...);
+    std::construct_at(const_cast<Key*>(std::addressof(result->get_pair().first)), key);
+    temp_ptr.ptr = {};
+
+    result->right_ = {};
+    result->left_ = {};
+    result->parent_ = {};
+    std::construct_at(std::addressof(result->augmentation_));
+    update(result);
+
+    return result;
+  }
+
+  void destroy_node(tree_node* node) noexcept
+  {
+    if (node == finger_)
+    {
+      finger_ = nullptr;
+    }
+
+    std::destroy_at(static_cast<data_node*>(node));
+    node_allocator_.deallocate(static_cast<data_node*>(node), 1);
+  }
+
+  void release_nodes() noexcept
+  {
+    root_ = nullptr;
+    begin_ = &end_;
+    end_.parent_ = nullptr;
+    finger_ = nullptr;
+    tree_size_ = 0;
+  }
+
+  std::size_t destroy_sub_tree(tree_node* sub_tree_root) noexcept
+  {
+    tree_node* current_node = sub_tree_root;
+    std::size_t count = 0;
+
+    while (current_node != nullptr)
+    {
+      if (current_node->left_ != nullptr)
+      {
+        tree_node* left_child = current_node->left_;
+        current_node->left_ = left_child->right_;
+        left_child->right_ = current_node;
+        current_node = left_child;
+      }
+      else
+      {
+        tree_node* next_node = current_node->right_;
+        destroy_node(current_node);
+        current_node = next_node;
+        count++;
+      }
+    }
+
+    return count;
+  }
+
+  tree_node* clone_node(tree_node* source_node, tree_node* parent)
+  {
+    tree_node* result = allocate_and_construct_node_emplace(source_node->get_pair().first, source_node->get_pair().second);
+    result->parent_ = parent;
+    result->augmentation_ = source_node->augmentation_;
+
+    return result;
+  }
+
+  void clone_from(const splay_tree& obj)
+  {
+    if (obj.root_ == nullptr)
+    {
+      return;
+    }
+
+    tree_node* source_node = obj.root_;
+    root_ = clone_node(source_node, nullptr);
+    tree_node* target_node = root_;
+
+    try
+    {
+      while (true)
+      {
+        if (source_node->left_ != nullptr && target_node->left_ == nullptr)
+        {
+          target_node->left_ = clone_node(source_node->left_, target_node);
+          source_node = source_node->left_;
+          target_node = target_node->left_;
+        }
+        else if (obj.is_data_node(source_node->right_) && target_node->right_ == nullptr)
+        {
+          target_node->right_ = clone_node(source_node->right_, target_node);
+          source_node = source_node->right_;
+          target_node = target_node->right_;
+        }
+        else
+        {
+          if (source_node == obj.begin_)
+          {
+            begin_ = target_node;
+          }
+
+          if (source_node == obj.end_.parent_)
+          {
+            end_.parent_ = target_node;
+          }
+
+          if (source_node == obj.root_)
+          {
+            break;
+          }
+
+          source_node = source_node->parent_;
+          target_node = target_node->parent_;
+        }
+      }
+    }
+    catch (...)
+    {
+      destroy_sub_tree(root_);
+      release_nodes();
+      throw;
+    }
+
+    end_.parent_->right_ = &end_;
+    tree_size_ = obj.tree_size_;
+  }
+
+  tree_node* detach_to_vine() noexcept
+  {
+    end_.parent_->right_ = nullptr;
+
+    tree_node head;
+    tree_node* tail = &head;
+    tree_node* rest = root_;
+    head.right_ = root_;
+
+    while (rest != nullptr)
+    {
+      if (rest->left_ == nullptr)
+      {
+        tail = rest;
+        rest = rest->right_;
+      }
+      else
+      {
+        tree_node* left_child = rest->left_;
+        push(rest);
+        push(left_child);
+        rest->left_ = left_child->right_;
+        left_child->right_ = rest;
+        rest = left_child;
+        tail->right_ = left_child;
+      }
+    }
+
+    tree_node* vine = head.right_;
+    release_nodes();
+
+    return vine;
+  }
+
+  static tree_node* build_balanced(tree_node*& vine, std::size_t count) noexcept
+  {
+    if (count == 0)
+    {
+      return nullptr;
+    }
+
+    std::size_t left_count = count / 2;
+    tree_node* left_sub_tree = build_balanced(vine, left_count);
+    tree_node* sub_tree_root = vine;
+    vine = vine->right_;
+    tree_node* right_sub_tree = build_balanced(vine, count - left_count - 1);
+
+    sub_tree_root->left_ = left_sub_tree;
+    sub_tree_root->right_ = right_sub_tree;
+
+    if (left_sub_tree)
+    {
+      left_sub_tree->parent_ = sub_tree_root;
+    }
+
+    if (right_sub_tree)
+    {
+      right_sub_tree->parent_ = sub_tree_root;
+    }
+
+    update(sub_tree_root);
+
+    return sub_tree_root;
+  }
+
+  void assign_vine(tree_node* vine, std::size_t count) noexcept
+  {
+    if (count == 0)
+    {
+      release_nodes();
+      return;
+    }
+
+    begin_ = vine;
+    root_ = build_balanced(vine, count);
+    root_->parent_ = nullptr;
+    end_.parent_ = find_sub_tree_max(root_);
+    end_.parent_->right_ = &end_;
+    tree_size_ = count;
+  }
+
+  void join_greater(splay_tree& obj) noexcept
+  {
+    splay(end_.parent_);
+    push(root_);
+    root_->right_ = obj.root_;
+    obj.root_->parent_ = root_;
+    end_.parent_ = obj.end_.parent_;
+    end_.parent_->right_ = &end_;
+    update(root_);
+    tree_size_ += obj.tree_size_;
+    obj.release_nodes();
+  }
+
+  void join_less(splay_tree& obj) noexcept
+  {
+    obj.splay(obj.end_.parent_);
+    push(obj.root_);
+    obj.root_->right_ = root_;
+    root_->parent_ = obj.root_;
+    root_ = obj.root_;
+    begin_ = obj.begin_;
+    update(root_);
+    tree_size_ += obj.tree_size_;
+    obj.release_nodes();
+  }
+
+  void merge_vines(splay_tree& obj) noexcept
+  {
+    tree_node* left_vine = detach_to_vine();
+    tree_node* right_vine = obj.detach_to_vine();
+    tree_node head;
+    tree_node* tail = &head;
+    std::size_t count = 0;
+
+    while (left_vine != nullptr && right_vine != nullptr)
+    {
+      if (compare(left_vine->get_pair().first, right_vine->get_pair().first))
+      {
+        tail->right_ = left_vine;
+        left_vine = left_vine->right_;
+      }
+      else if (compare(right_vine->get_pair().first, left_vine->get_pair().first))
+      {
+        tail->right_ = right_vine;
+        right_vine = right_vine->right_;
+      }
+      else
+      {
+        tree_node* duplicate = right_vine;
+        right_vine = right_vine->right_;
+        destroy_node(duplicate);
+        continue;
+      }
+
+      tail = tail->right_;
+      ++count;
+    }
+
+    for (tail->right_ = left_vine ? left_vine : right_vine; tail->right_ != nullptr; tail = tail->right_)
+    {
+      ++count;
+    }
+
+    assign_vine(head.right_, count);
+  }
+
+  splay_tree empty_sibling() const
+  {
+    return splay_tree{ comparator_, get_allocator() };
+  }
+
+  template<std::input_iterator It>
+  void assign_sorted(It begin, It end)
+  {
+    tree_node head;
+    tree_node* tail = &head;
+    std::size_t count = 0;
+
+    try
+    {
+      for (; begin != end; ++begin)
+      {
+        tail->right_ = allocate_and_construct_node_emplace((*begin).first, (*begin).second);
+        tail = tail->right_;
+        ++count;
+      }
+    }
+    catch (...)
+    {
+      for (tree_node* current_node = head.right_; count != 0; --count)
+      {
+        tree_node* next_node = current_node->right_;
+        destroy_node(current_node);
+        current_node = next_node;
+      }
+
+      throw;
+    }
+
+    assign_vine(head.right_, count);
+  }
+
+  template<std::input_iterator It>
+  void insert_sorted(It begin, It end, std::size_t count)
+  {
+    if (root_ == nullptr)
+    {
+      assign_sorted(begin, end);
+    }
+    else if (count * 8 < tree_size_)
+    {
+      for (; begin != end; ++begin)
+      {
+        insert(*begin);
+      }
+    }
+    else
+    {
+      splay_tree sorted_part = empty_sibling();
+      sorted_part.assign_sorted(begin, end);
+      merge(sorted_part);
+    }
+  }
+
+  std::pair<tree_node*, tree_node*> find_internal(const Key& key) const noexcept
+  {
+    return find_internal(key, root_);
+  }
+
+  std::pair<tree_node*, tree_node*> find_internal(const Key& key, tree_node* sub_tree_root) const noexcept
+  {
+    std::size_t depth = 0;
+
+    return find_internal(key, sub_tree_root, depth);
+  }
+
+  // Also reports how many nodes the descent visited, so the splay policy does not have to climb back to measure depth.
+  std::pair<tree_node*, tree_node*> find_internal(const Key& key, tree_node* sub_tree_root, std::size_t& depth) const noexcept
+  {
+    tree_node* current_node = sub_tree_root, * prev_node = {};
+
+    while (current_node && current_node != &end_)
+    {
+      prev_node = current_node;
+      push(current_node);
+      ++depth;
+
+      if (compare(key, current_node->get_pair().first))
+      {
+        current_node = current_node->left_;
+      }
+      else if (compare(current_node->get_pair().first, key))
+      {
+        current_node = current_node->right_;
+      }
+      else
+      {
+        break;
+      }
+    }
+
+    stats_.count_depth(depth);
+
+    return { current_node, prev_node };
+  }
+
+  // Climbs from the finger to the lowest ancestor whose subtree spans key.
+  tree_node* finger_ancestor(tree_node* finger, const Key& key) const noexcept
+  {
+    if (!is_data_node(finger) || Augmentation::is_lazy)
+    {
+      return root_;
+    }
+
+    bool key_is_greater = compare(finger->get_pair().first, key);
+
+    if (!key_is_greater && !compare(key, finger->get_pair().first))
+    {
+      return finger;
+    }
+
+    tree_node* current_node = finger;
+
+    for (; current_node->parent_ != nullptr; current_node = current_node->parent_)
+    {
+      tree_node* parent = current_node->parent_;
+
+      if ((parent->left_ == current_node) == key_is_greater)
+      {
+        const Key& bound = parent->get_pair().first;
+
+        if (key_is_greater ? compare(key, bound) : compare(bound, key))
+        {
+          break;
+        }
+
+        if (key_is_greater ? !compare(bound, key) : !compare(key, bound))
+        {
+          return parent;
+        }
+      }
+    }
+
+    return current_node;
+  }
+
+  static void check_batch_size(std::size_t key_count, std::size_t result_count)
+  {
+    if (result_count < key_count)
+    {
+      throw std::length_error{ "splay_tree: result buffer is shorter than the key batch." };
+    }
+  }
+
+  // Resolves the queries in the given order, each search starting from the node located by the previous one,
+  // and splays the node of the middle query once at the end.
+  template<class Order, class Output>
+  void locate_many(std::span<const Key> keys, Order&& order, Output&& output)
+  {
+    tree_node* finger = nullptr;
+    tree_node* middle_node = nullptr;
+
+    for (std::size_t j = 0; j < keys.size(); j++)
+    {
+      std::size_t index = order(j);
+      const Key& key = keys[index];
+      auto [target_node, prev_node] = find_internal(key, finger_ancestor(finger, key));
+      bool found = is_data_node(target_node);
+
+      finger = found ? target_node : prev_node;
+      output(index, found ? target_node : &end_);
+
+      if (j == keys.size() / 2)
+      {
+        middle_node = finger;
+      }
+    }
+
+    if (is_data_node(middle_node))
+    {
+      policy_splay(middle_node);
+    }
+  }
+
+  template<class Output>
+  void locate_many(std::span<const Key> keys, Output&& output)
+  {
+    std::vector<std::size_t> order(keys.size());
+    std::iota(order.begin(), order.end(), std::size_t{ 0 });
+    std::ranges::sort(order, [this, keys](std::size_t lhs, std::size_t rhs) { return compare(keys[lhs], keys[rhs]); });
+
+    locate_many(keys, [&order](std::size_t j) { return order[j]; }, std::forward<Output>(output));
+  }
+
+  // Advances up to GroupSize independent descents in lockstep and prefetches the next node of each one,
+  // so the cache misses of a group overlap instead of being paid one after another.
+  template<std::size_t GroupSize, class Output>
+  void interleaved_locate(std::span<const Key> keys, Output&& output) const
+  {
+    static_assert(GroupSize > 0);
+
+    for (std::size_t first = 0; first < keys.size(); first += GroupSize)
+    {
+      std::size_t count = std::min(GroupSize, keys.size() - first);
+      std::array<tree_node*, GroupSize> cursors{};
+      std::size_t active = 0;
+
+      for (std::size_t j = 0; j < count; j++)
+      {
+        if (is_data_node(root_))
+        {
+          cursors[j] = root_;
+          ++active;
+        }
+        else
+        {
+          output(first + j, &end_);
+        }
+      }
+
+      while (active != 0)
+      {
+        for (std::size_t j = 0; j < count; j++)
+        {
+          tree_node* current_node = cursors[j];
+
+          if (current_node == nullptr)
+          {
+            continue;
+          }
+
+          push(current_node);
+          const Key& key = keys[first + j];
+          tree_node* next_node;
+
+          if (compare(key, current_node->get_pair().first))
+          {
+            next_node = current_node->left_;
+          }
+          else if (compare(current_node->get_pair().first, key))
+          {
+            next_node = current_node->right_;
+          }
+          else
+          {
+            output(first + j, current_node);
+            cursors[j] = nullptr;
+            --active;
+            continue;
+          }
+
+          if (is_data_node(next_node))
+          {
+            internal::prefetch(next_node);
+            cursors[j] = next_node;
+          }
+          else
+          {
+            output(first + j, &end_);
+            cursors[j] = nullptr;
+            --active;
+          }
+        }
+      }
+    }
+  }
+
+  std::pair<tree_node*, bool> access(const Key& key) noexcept
+  {
+    if (root_ == nullptr)
+    {
+      return { &end_, false };
+    }
+
+    if constexpr (SplayPolicy::is_top_down)
+    {
+      auto [new_root, found] = splay_top_down(root_, key);
+      root_ = new_root;
+
+      return { root_, found };
+    }
+    else
+    {
+      std::size_t visited = 0;
+      auto [target_node, prev_node] = find_internal(key, root_, visited);
+      bool found = is_data_node(target_node);
+      tree_node* accessed_node = found ? target_node : prev_node;
+
+      // The accessed node is the last one visited, so the root is at depth zero.
+      if (splay_policy_.should_splay(visited - 1, tree_size_, found))
+      {
+        policy_splay(accessed_node);
+      }
+      else
+      {
+        stats_.count_skipped_splay();
+      }
+
+      return { accessed_node, found };
+    }
+  }
+
+  std::pair<tree_node*, bool> locate(const Key& key) const noexcept
+  {
+    auto [target_node, prev_node] = find_internal(key);
+
+    if (is_data_node(target_node))
+    {
+      return { target_node, true };
+    }
+
+    return { prev_node ? prev_node : &end_, false };
+  }
+
+  tree_node* lower_bound_node(std::pair<tree_node*, bool> located, const Key& key) const noexcept
+  {
+    auto [target_node, found] = located;
+
+    if (!found && target_node != &end_ && compare(target_node->get_pair().first, key))
+    {
+      return (++iterator{ target_node }).node_;
+    }
+
+    return target_node;
+  }
+
+  tree_node* upper_bound_node(std::pair<tree_node*, bool> located, const Key& key) const noexcept
+  {
+    auto [target_node, found] = located;
+
+    if (found || (target_node != &end_ && compare(target_node->get_pair().first, key)))
+    {
+      return (++iterator{ target_node }).node_;
+    }
+
+    return target_node;
+  }
+
+  void erase_internal(tree_node* target_node) noexcept
+  {
+    if constexpr (SplayPolicy::is_top_down)
+    {
+      root_ = splay_top_down(root_, target_node->get_pair().first).first;
+      remove_root();
+      return;
+    }
+
+    splay(target_node);
+    push(target_node);
+
+    tree_node* left_sub_tree = target_node->left_;
+    tree_node* right_sub_tree = target_node->right_;
+
+    if (left_sub_tree == nullptr && !is_data_node(right_sub_tree))
+    {
+      begin_ = &end_;
+      end_.parent_ = nullptr;
+      root_ = nullptr;
+    }
+    else if (left_sub_tree == nullptr)
+    {
+      begin_ = find_sub_tree_min(right_sub_tree);
+      splay(begin_);
+      begin_->left_ = nullptr;
+      update(begin_);
+    }
+    else if (right_sub_tree == nullptr)
+    {
+      tree_node* new_root = find_sub_tree_max(left_sub_tree);
+      splay(new_root);
+      new_root->right_ = &end_;
+      end_.parent_ = new_root;
+      update(new_root);
+    }
+    else
+    {
+      tree_node* new_root = find_sub_tree_max(left_sub_tree);
+      splay(new_root);
+      new_root->right_ = right_sub_tree;
+      right_sub_tree->parent_ = new_root;
+      update(new_root);
+    }
+
+    destroy_node(target_node);
+    --tree_size_;
+  }
+
+  void rewire_end() noexcept
+  {
+    if (root_ == nullptr)
+    {
+      begin_ = &end_;
+    }
+    else
+    {
+      end_.parent_->right_ = &end_;
+    }
+  }
+
+  static tree_node* find_sub_tree_min(tree_node* obj) noexcept
+  {
+    tree_node* current_node = obj;
+
+    for (; current_node->left_ != nullptr; current_node = current_node->left_)
+    {
+      push(current_node);
+    }
+
+    return current_node;
+  }
+
+  static tree_node* find_sub_tree_max(tree_node* obj) noexcept
+  {
+    tree_node* current_node = obj;
+
+    for (; current_node->right_ != nullptr; current_node = current_node->right_)
+    {
+      push(current_node);
+    }
+
+    return current_node;
+  }
+
+  void zig(tree_node* target_node) noexcept
+  {
+    stats_.count_rotation(splay_stats::rotation::zig);
+    root_ = target_node;
+    tree_node* target_node_parent = target_node->parent_;
+    push(target_node_parent);
+    push(target_node);
+    tree_node* target_node_right_child = target_node->right_;
+
+    target_node->parent_ = nullptr;
+    target_node->right_ = target_node_parent;
+    target_node_parent->parent_ = target_node;
+    target_node_parent->left_ = target_node_right_child;
+
+    if (target_node_right_child)
+    {
+      target_node_right_child->parent_ = target_node_parent;
+    }
+
+    update(target_node_parent);
+    update(target_node);
+  }
+
+  void zag(tree_node* target_node) noexcept
+  {
+    stats_.count_rotation(splay_stats::rotation::zag);
+    root_ = target_node;
+    tree_node* target_node_parent = target_node->parent_;
+    push(target_node_parent);
+    push(target_node);
+    tree_node* target_node_left_child = target_node->left_;
+
+    target_node->parent_ = nullptr;
+    target_node->left_ = target_node_parent;
+    target_node_parent->parent_ = target_node;
+    target_node_parent->right_ = target_node_left_child;
+
+    if (target_node_left_child)
+    {
+      target_node_left_child->parent_ = target_node_parent;
+    }
+
+    update(target_node_parent);
+    update(target_node);
+  }
+
+  void zig_zig(tree_node* target_node_parent) noexcept
+  {
+    stats_.count_rotation(splay_stats::rotation::zig_zig);
+    tree_node* target_node = target_node_parent->left_;
+    tree_node* sub_tree_root = target_node_parent->parent_;
+    tree_node* grandparent = sub_tree_root->parent_;
+    push(sub_tree_root);
+    push(target_node_parent);
+    push(target_node);
+    tree_node* target_node_parent_right_child = target_node_parent->right_;
+
+    target_node_parent->parent_ = target_node;
+
+    if (target_node_parent_right_child)
+    {
+      target_node_parent_right_child->parent_ = sub_tree_root;
+    }
+
+    target_node_parent->left_ = target_node->right_;
+
+    if (target_node->right_)
+    {
+      target_node->right_->parent_ = target_node_parent;
+    }
+
+    target_node->right_ = target_node_parent;
+
+    target_node->parent_ = sub_tree_root->parent_;
+    sub_tree_root->parent_ = target_node_parent;
+
+    sub_tree_root->left_ = target_node_parent_right_child;
+    target_node_parent->right_ = sub_tree_root;
+
+    if (grandparent)
+    {
+      if (grandparent->left_ == sub_tree_root) grandparent->left_ = target_node;
+      else grandparent->right_ = target_node;
+    }
+    else
+    {
+      root_ = target_node;
+    }
+
+    update(sub_tree_root);
+    update(target_node_parent);
+    update(target_node);
+  }
+
+  void zag_zag(tree_node* target_node_parent) noexcept
+  {
+    stats_.count_rotation(splay_stats::rotation::zag_zag);
+    tree_node* target_node = target_node_parent->right_;
+    tree_node* sub_tree_root = target_node_parent->parent_;
+    tree_node* grandparent = sub_tree_root->parent_;
+    push(sub_tree_root);
+    push(target_node_parent);
+    push(target_node);
+    tree_node* target_node_parent_left_child = target_node_parent->left_;
+
+    target_node_parent->parent_ = target_node;
+
+    if (target_node_parent_left_child)
+    {
+      target_node_parent_left_child->parent_ = sub_tree_root;
+    }
+
+    target_node_parent->right_ = target_node->left_;
+
+    if (target_node->left_)
+    {
+      target_node->left_->parent_ = target_node_parent;
+    }
+
+    target_node->left_ = target_node_parent;
+
+    target_node->parent_ = sub_tree_root->parent_;
+    sub_tree_root->parent_ = target_node_parent;
+
+    sub_tree_root->right_ = target_node_parent_left_child;
+    target_node_parent->left_ = sub_tree_root;
+
+    if (grandparent)
+    {
+      if (grandparent->left_ == sub_tree_root) grandparent->left_ = target_node;
+      else grandparent->right_ = target_node;
+    }
+    else
+    {
+      root_ = target_node;
+    }
+
+    update(sub_tree_root);
+    update(target_node_parent);
+    update(target_node);
+  }
+
+  void zig_zag(tree_node* target_node_parent) noexcept
+  {
+    stats_.count_rotation(splay_stats::rotation::zig_zag);
+    tree_node* target_node = target_node_parent->left_;
+    tree_node* sub_tree_root = target_node_parent->parent_;
+    tree_node* grandparent = sub_tree_root->parent_;
+    push(sub_tree_root);
+    push(target_node_parent);
+    push(target_node);
+
+    target_node->parent_ = sub_tree_root->parent_;
+
+    if (target_node->left_)
+    {
+      target_node->left_->parent_ = sub_tree_root;
+    }
+
+    sub_tree_root->right_ = target_node->left_;
+    target_node->left_ = sub_tree_root;
+
+    if (target_node->right_)
+    {
+      target_node->right_->parent_ = target_node_parent;
+    }
+
+    target_node_parent->left_ = target_node->right_;
+    target_node->right_ = target_node_parent;
+    target_node_parent->parent_ = target_node;
+    sub_tree_root->parent_ = target_node;
+
+    if (grandparent)
+    {
+      if (grandparent->left_ == sub_tree_root) grandparent->left_ = target_node;
+      else grandparent->right_ = target_node;
+    }
+    else
+    {
+      root_ = target_node;
+    }
+
+    update(sub_tree_root);
+    update(target_node_parent);
+    update(target_node);
+  }
+
+  void zag_zig(tree_node* target_node_parent) noexcept
+  {
+    stats_.count_rotation(splay_stats::rotation::zag_zig);
+    tree_node* target_node = target_node_parent->right_;
+    tree_node* sub_tree_root = target_node_parent->parent_;
     tree_node* grandparent = sub_tree_root->parent_;
+    push(sub_tree_root);
+    push(target_node_parent);
+    push(target_node);
+
+    target_node->parent_ = sub_tree_root->parent_;
+
+    if (target_node->right_)
+    {
+      target_node->right_->parent_ = sub_tree_root;
+    }
+
+    sub_tree_root->left_ = target_node->right_;
+    target_node->right_ = sub_tree_root;
+
+    if (target_node->left_)
+    {
+      target_node->left_->parent_ = target_node_parent;
+    }
+
+    target_node_parent->right_ = target_node->left_;
+    target_node->left_ = target_node_parent;
+    target_node_parent->parent_ = target_node;
+    sub_tree_root->parent_ = target_node;
+
+    if (grandparent)
+    {
+      if (grandparent->left_ == sub_tree_root) grandparent->left_ = target_node;
+      else grandparent->right_ = target_node;
+    }
+    else
+    {
+      root_ = target_node;
+    }
+
+    update(sub_tree_root);
+    update(target_node_parent);
+    update(target_node);
+  }
+
+  void splay(tree_node* target_node) noexcept
+  {
+    while (target_node->parent_ != nullptr)
+    {
+      tree_node* parent = target_node->parent_;
+      tree_node* grandparent = parent->parent_;
+
+      if (grandparent == nullptr)
+      {
+        if (parent->left_ == target_node)
+        {
+          zig(target_node);
+        }
+        else
+        {
+          zag(target_node);
+        }
+      }
+      else if (grandparent->left_ == parent && parent->left_ == target_node)
+      {
+        zig_zig(parent);
+      }
+      else if (grandparent->right_ == parent && parent->right_ == target_node)
+      {
+        zag_zag(parent);
+      }
+      else if (grandparent->right_ == parent && parent->left_ == target_node)
+      {
+        zig_zag(parent);
+      }
+      else
+      {
+        zag_zig(parent);
+      }
+    }
+  }
+
+  static void update(tree_node* node) noexcept
+  {
+    if constexpr (!std::is_empty_v<typename Augmentation::node_data>)
+    {
+      static const typename Augmentation::node_data empty_sub_tree{};
+
+      Augmentation::update(node->augmentation_, node->get_pair(),
+        node->left_ ? node->left_->augmentation_ : empty_sub_tree,
+        node->right_ ? node->right_->augmentation_ : empty_sub_tree);
+    }
+  }
+
+  static void push(tree_node* node) noexcept
+  {
+    if constexpr (Augmentation::is_lazy)
+    {
+      auto& node_data = node->augmentation_;
+
+      if (Augmentation::has_pending(node_data))
+      {
+        if (node->left_)
+        {
+          Augmentation::apply(node->left_->augmentation_, node->left_->get_pair(), node_data.tag);
+        }
+
+        if (node->right_ && node->right_->augmentation_.size != 0)
+        {
+          Augmentation::apply(node->right_->augmentation_, node->right_->get_pair(), node_data.tag);
+        }
+
+        Augmentation::clear_pending(node_data);
+      }
+    }
+  }
+
+  static std::size_t sub_tree_size(const tree_node* node) noexcept
+  {
+    return node ? node->augmentation_.size : 0;
+  }
+
+  static std::size_t index_of(const tree_node* node) noexcept
+  {
+    std::size_t index = sub_tree_size(node->left_);
+
+    for (; node->parent_ != nullptr; node = node->parent_)
+    {
+      if (node->parent_->right_ == node)
+      {
+        index += sub_tree_size(node->parent_->left_) + 1;
+      }
+    }
+
+    return index;
+  }
+
+  tree_node* find_nth(std::size_t index) const noexcept
+  {
+    if (index >= tree_size_)
+    {
+      return &end_;
+    }
+
+    tree_node* current_node = root_;
+
+    while (true)
+    {
+      std::size_t left_size = sub_tree_size(current_node->left_);
+      push(current_node);
+
+      if (index < left_size)
+      {
+        current_node = current_node->left_;
+      }
+      else if (index == left_size)
+      {
+        return current_node;
+      }
+      else
+      {
+        index -= left_size + 1;
+        current_node = current_node->right_;
+      }
+    }
+  }
+
+  std::pair<tree_node*, tree_node*> split_sub_tree(tree_node* sub_tree_root, const Key& key) noexcept
+  {
+    if (sub_tree_root == nullptr)
+    {
+      return {};
+    }
+
+    sub_tree_root = splay_top_down(sub_tree_root, key).first;
+
+    if (compare(sub_tree_root->get_pair().first, key))
+    {
+      tree_node* right_part = sub_tree_root->right_;
+      sub_tree_root->right_ = nullptr;
+      update(sub_tree_root);
+
+      if (right_part)
+      {
+        right_part->parent_ = nullptr;
+      }
+
+      return { sub_tree_root, right_part };
+    }
+
+    tree_node* left_part = sub_tree_root->left_;
+    sub_tree_root->left_ = nullptr;
+    update(sub_tree_root);
+
+    if (left_part)
+    {
+      left_part->parent_ = nullptr;
+    }
+
+    return { left_part, sub_tree_root };
+  }
+
+  tree_node* join_sub_trees(tree_node* left_part, tree_node* right_part) noexcept
+  {
+    if (left_part == nullptr)
+    {
+      return right_part;
+    }
+
+    if (right_part == nullptr)
+    {
+      return left_part;
+    }
+
+    left_part = splay_top_down(left_part, right_part->get_pair().first).first;
+    left_part->right_ = right_part;
+    right_part->parent_ = left_part;
+    update(left_part);
+
+    return left_part;
+  }
+
+  static tree_node* sub_tree_successor(tree_node* node) noexcept
+  {
+    if (node->right_ != nullptr)
+    {
+      push(node);
+      return find_sub_tree_min(node->right_);
+    }
+
+    for (; node->parent_ != nullptr && node->parent_->right_ == node; node = node->parent_);
+
+    return node->parent_;
+  }
+
+  // Without stored subtree sizes both parts are walked in lockstep, so the cost is linear in the smaller one.
+  std::size_t left_part_size(tree_node* left_part, tree_node* right_part) const noexcept
+  {
+    if constexpr (Augmentation::maintains_size)
+    {
+      return sub_tree_size(left_part);
+    }
+    else
+    {
+      tree_node* left_node = begin_;
+      tree_node* right_node = find_sub_tree_min(right_part);
+
+      for (std::size_t count = 0;; count++)
+      {
+        if (left_node == nullptr)
+        {
+          return count;
+        }
+
+        if (right_node == nullptr)
+        {
+          return tree_size_ - count;
+        }
+
+        left_node = sub_tree_successor(left_node);
+        right_node = sub_tree_successor(right_node);
+      }
+    }
+  }
+
+  template<class Operation>
+  void visit_range(const Key& low, const Key& high, Operation&& operation)
+  {
+    end_.parent_->right_ = nullptr;
+
+    auto [left_part, rest] = split_sub_tree(root_, low);
+    auto [middle_part, right_part] = split_sub_tree(rest, high);
+
+    operation(middle_part);
+
+    root_ = join_sub_trees(left_part, join_sub_trees(middle_part, right_part));
+    root_->parent_ = nullptr;
+    end_.parent_->right_ = &end_;
+  }
+
+  // Erases [low, high), or every key not less than low when high is null.
+  std::size_t erase_key_range(const Key& low, const Key* high) noexcept
+  {
+    if (root_ == nullptr || (high != nullptr && !compare(low, *high)))
+    {
+      return 0;
+    }
+
+    tree_node* max_node = end_.parent_;
+    max_node->right_ = nullptr;
+
+    auto [left_part, middle_part] = split_sub_tree(root_, low);
+    tree_node* right_part = nullptr;
+
+    if (high != nullptr)
+    {
+      auto [lower_part, upper_part] = split_sub_tree(middle_part, *high);
+      middle_part = lower_part;
+      right_part = upper_part;
+    }
+
+    if (left_part == nullptr && right_part != nullptr)
+    {
+      right_part = splay_top_down(right_part, *high).first;
+      begin_ = right_part;
+    }
+
+    if (right_part == nullptr && left_part != nullptr)
+    {
+      left_part = splay_top_down(left_part, low).first;
+      max_node = left_part;
+    }
+
+    // low may refer to a key of the erased range, so it must not be used past this point.
+    std::size_t count = destroy_sub_tree(middle_part);
+    tree_size_ -= count;
+    root_ = join_sub_trees(left_part, right_part);
+
+    if (root_ == nullptr)
+    {
+      release_nodes();
+      return count;
+    }
+
+    end_.parent_ = max_node;
+    max_node->right_ = &end_;
+
+    return count;
+  }
+
+  void rotate_up(tree_node* target_node) noexcept
+  {
+    tree_node* parent = target_node->parent_;
+    tree_node* grandparent = parent->parent_;
+    push(parent);
+    push(target_node);
+    stats_.count_rotation(parent->left_ == target_node ? splay_stats::rotation::zig : splay_stats::rotation::zag);
+
+    if (parent->left_ == target_node)
+    {
+      parent->left_ = target_node->right_;
+
+      if (target_node->right_)
+      {
+        target_node->right_->parent_ = parent;
+      }
+
+      target_node->right_ = parent;
+    }
+    else
+    {
+      parent->right_ = target_node->left_;
+
+      if (target_node->left_)
+      {
+        target_node->left_->parent_ = parent;
+      }
+
+      target_node->left_ = parent;
+    }
+
+    parent->parent_ = target_node;
+    target_node->parent_ = grandparent;
+
+    if (grandparent == nullptr)
+    {
+      root_ = target_node;
+    }
+    else if (grandparent->left_ == parent)
+    {
+      grandparent->left_ = target_node;
+    }
+    else
+    {
+      grandparent->right_ = target_node;
+    }
+
+    update(parent);
+    update(target_node);
+  }
+
+  void semi_splay(tree_node* target_node) noexcept
+  {
+    while (target_node->parent_ != nullptr)
+    {
+      tree_node* parent = target_node->parent_;
+      tree_node* grandparent = parent->parent_;
+
+      if (grandparent == nullptr)
+      {
+        rotate_up(target_node);
+      }
+      else if ((grandparent->left_ == parent) == (parent->left_ == target_node))
+      {
+        rotate_up(parent);
+        target_node = parent;
+      }
+      else if (grandparent->right_ == parent)
+      {
+        zig_zag(parent);
+      }
+      else
+      {
+        zag_zig(parent);
+      }
+    }
+  }
+
+  void policy_splay(tree_node* target_node) noexcept
+  {
+    if constexpr (SplayPolicy::is_semi_splay)
+    {
+      semi_splay(target_node);
+    }
+    else
+    {
+      splay(target_node);
+    }
+  }
+
+  bool is_data_node(const tree_node* node) const noexcept
+  {
+    return node != nullptr && node != &end_;
+  }
+
+  std::pair<tree_node*, bool> splay_top_down(tree_node* sub_tree_root, const Key& key) noexcept
+  {
+    tree_node header;
+    tree_node* left_tree_max = &header;
+    tree_node* right_tree_min = &header;
+    tree_node* current_node = sub_tree_root;
+    bool found = false;
+    std::size_t depth = 0;
+
+    while (true)
+    {
+      push(current_node);
+      ++depth;
+
+      if (compare(key, current_node->get_pair().first))
+      {
+        tree_node* child = current_node->left_;
+
+        if (child == nullptr)
+        {
+          break;
+        }
+
+        if (compare(key, child->get_pair().first))
+        {
+          stats_.count_rotation(splay_stats::rotation::zig_zig);
+          push(child);
+          current_node->left_ = child->right_;
+
+          if (child->right_)
+          {
+            child->right_->parent_ = current_node;
+          }
+
+          child->right_ = current_node;
+          current_node->parent_ = child;
+          update(current_node);
+          current_node = child;
+
+          if (current_node->left_ == nullptr)
+          {
+            break;
+          }
+        }
+        else
+        {
+          stats_.count_rotation(splay_stats::rotation::zig);
+        }
+
+        right_tree_min->left_ = current_node;
+        current_node->parent_ = right_tree_min;
+        right_tree_min = current_node;
+        current_node = current_node->left_;
+      }
+      else if (compare(current_node->get_pair().first, key))
+      {
+        tree_node* child = current_node->right_;
+
+        if (!is_data_node(child))
+        {
+          break;
+        }
+
+        if (compare(child->get_pair().first, key))
+        {
+          stats_.count_rotation(splay_stats::rotation::zag_zag);
+          push(child);
+          current_node->right_ = child->left_;
+
+          if (child->left_)
+          {
+            child->left_->parent_ = current_node;
+          }
+
+          child->left_ = current_node;
+          current_node->parent_ = child;
+          update(current_node);
+          current_node = child;
+
+          if (!is_data_node(current_node->right_))
+          {
+            break;
+          }
+        }
+        else
+        {
+          stats_.count_rotation(splay_stats::rotation::zag);
+        }
+
+        left_tree_max->right_ = current_node;
+        current_node->parent_ = left_tree_max;
+        left_tree_max = current_node;
+        current_node = current_node->right_;
+      }
+      else
+      {
+        found = true;
+        break;
+      }
+    }
+
+    stats_.count_depth(depth);
+    left_tree_max->right_ = current_node->left_;
+    right_tree_min->left_ = current_node->right_;
+
+    if (left_tree_max->right_)
+    {
+      left_tree_max->right_->parent_ = left_tree_max;
+    }
 
-    target_node->parent_ = sub_tree_root->parent_;
+    if (right_tree_min->left_)
+    {
+      right_tree_min->left_->parent_ = right_tree_min;
+    }
 
-    if (target_node->right_)
+    current_node->left_ = header.right_;
+    current_node->right_ = header.left_;
+    current_node->parent_ = nullptr;
+
+    if (current_node->left_)
     {
-      target_node->right_->parent_ = sub_tree_root;
+      current_node->left_->parent_ = current_node;
     }
 
-    sub_tree_root->left_ = target_node->right_;
-    target_node->right_ = sub_tree_root;
+    if (current_node->right_)
+    {
+      current_node->right_->parent_ = current_node;
+    }
 
-    if (target_node->left_)
+    if constexpr (!std::is_empty_v<typename Augmentation::node_data>)
     {
-      target_node->left_->parent_ = target_node_parent;
+      for (tree_node* spine_node = left_tree_max; spine_node != &header; spine_node = spine_node->parent_)
+      {
+        update(spine_node);
+
+        if (spine_node->parent_ == current_node)
+        {
+          break;
+        }
+      }
+
+      for (tree_node* spine_node = right_tree_min; spine_node != &header; spine_node = spine_node->parent_)
+      {
+        update(spine_node);
+
+        if (spine_node->parent_ == current_node)
+        {
+          break;
+        }
+      }
+
+      update(current_node);
+    }
+
+    return { current_node, found };
+  }
+
+  void remove_root() noexcept
+  {
+    tree_node* target_node = root_;
+    tree_node* left_sub_tree = target_node->left_;
+    tree_node* right_sub_tree = target_node->right_;
+    const Key& key = target_node->get_pair().first;
+
+    if (left_sub_tree != nullptr)
+    {
+      left_sub_tree->parent_ = nullptr;
+      root_ = splay_top_down(left_sub_tree, key).first;
+      root_->right_ = right_sub_tree;
+
+      if (right_sub_tree)
+      {
+        right_sub_tree->parent_ = root_;
+      }
+
+      update(root_);
+    }
+    else if (right_sub_tree != &end_)
+    {
+      right_sub_tree->parent_ = nullptr;
+      root_ = splay_top_down(right_sub_tree, key).first;
+      begin_ = root_;
+    }
+    else
+    {
+      root_ = nullptr;
+      begin_ = &end_;
+      end_.parent_ = nullptr;
+    }
+
+    destroy_node(target_node);
+    --tree_size_;
+  }
+
+public:
+  splay_tree() : node_allocator_{}, comparator_{}
+  {}
+
+  explicit splay_tree(const Allocator& alloc) : node_allocator_{ alloc }, comparator_{}
+  {}
+
+  explicit splay_tree(const Comparator& comp, const Allocator& alloc = Allocator{}) : node_allocator_{ alloc }, comparator_{ comp }
+  {}
+
+  splay_tree(std::initializer_list<value_type> list, const Comparator& comp = Comparator{}, const Allocator& alloc = Allocator{})
+    : node_allocator_{ alloc }, comparator_{ comp }
+  {
+    insert(list);
+  }
+
+  template<std::input_iterator It>
+  splay_tree(It begin, It end, const Comparator& comp = Comparator{}, const Allocator& alloc = Allocator{})
+    : node_allocator_{ alloc }, comparator_{ comp }
+  {
+    insert(begin, end);
+  }
+
+  splay_tree(sorted_unique_t, std::initializer_list<value_type> list, const Comparator& comp = Comparator{}, const Allocator& alloc = Allocator{})
+    : node_allocator_{ alloc }, comparator_{ comp }
+  {
+    assign_sorted(list.begin(), list.end());
+  }
+
+  template<std::input_iterator It>
+  splay_tree(sorted_unique_t, It begin, It end, const Comparator& comp = Comparator{}, const Allocator& alloc = Allocator{})
+    : node_allocator_{ alloc }, comparator_{ comp }
+  {
+    assign_sorted(begin, end);
+  }
+
+  splay_tree(const splay_tree& obj)
+    : node_allocator_{ std::allocator_traits<node_allocator_type>::select_on_container_copy_construction(obj.node_allocator_) },
+    comparator_{ obj.comparator_ }
+  {
+    clone_from(obj);
+  }
+
+  splay_tree(const splay_tree& obj, rebalanced_copy_t)
+    : node_allocator_{ std::allocator_traits<node_allocator_type>::select_on_container_copy_construction(obj.node_allocator_) },
+    comparator_{ obj.comparator_ }
+  {
+    assign_sorted(obj.begin(), obj.end());
+  }
+
+  splay_tree(splay_tree&& obj) noexcept : node_allocator_{ obj.node_allocator_ }
+  {
+    swap(obj);
+  }
+
+  splay_tree& operator=(const splay_tree& obj)
+  {
+    if (&obj == this)
+    {
+      return *this;
+    }
+
+    splay_tree{ obj }.swap(*this);
+
+    return *this;
+  }
+
+  splay_tree& operator=(splay_tree&& obj)
+  {
+    if (&obj == this)
+    {
+      return *this;
+    }
+
+    swap(obj);
+
+    return *this;
+  }
+
+  ~splay_tree() noexcept
+  {
+    clear();
+  }
+
+  Data& at(const Key& key)
+  {
+    auto result = find(key);
+
+    if (result.node_ == &end_)
+    {
+      throw std::out_of_range{ "splay_tree: key was out of range." };
     }
 
-    target_node_parent->right_ = target_node->left_;
-    target_node->left_ = target_node_parent;
-    target_node_parent->parent_ = target_node;
-    sub_tree_root->parent_ = target_node;
+    return result->second;
+  }
+
+  iterator find(const Key& key) noexcept
+  {
+    auto [target_node, found] = access(key);
+
+    return found ? iterator{ target_node } : end();
+  }
+
+  const_iterator find(const Key& key) const noexcept
+  {
+    auto [target_node, found] = locate(key);
+
+    return found ? const_iterator{ target_node } : end();
+  }
+
+  const Data& at(const Key& key) const
+  {
+    auto [target_node, found] = locate(key);
+
+    if (!found)
+    {
+      throw std::out_of_range{ "splay_tree: key was out of range." };
+    }
+
+    return target_node->get_pair().second;
+  }
+
+  iterator lower_bound(const Key& key) noexcept
+  {
+    return iterator{ lower_bound_node(access(key), key) };
+  }
+
+  const_iterator lower_bound(const Key& key) const noexcept
+  {
+    return const_iterator{ lower_bound_node(locate(key), key) };
+  }
+
+  iterator upper_bound(const Key& key) noexcept
+  {
+    return iterator{ upper_bound_node(access(key), key) };
+  }
+
+  const_iterator upper_bound(const Key& key) const noexcept
+  {
+    return const_iterator{ upper_bound_node(locate(key), key) };
+  }
+
+  iterator find_near(const_iterator finger, const Key& key) noexcept
+  {
+    auto [target_node, prev_node] = find_internal(key, finger_ancestor(finger.it_.node_, key));
+
+    if (is_data_node(target_node))
+    {
+      finger_ = target_node;
+      return iterator{ target_node };
+    }
+
+    finger_ = prev_node;
+
+    return end();
+  }
+
+  iterator find_near(const Key& key) noexcept
+  {
+    return find_near(const_iterator{ iterator{ finger_ } }, key);
+  }
+
+  void find_many(std::span<const Key> keys, std::span<iterator> results)
+  {
+    check_batch_size(keys.size(), results.size());
+    locate_many(keys, [results](std::size_t index, tree_node* node) { results[index] = iterator{ node }; });
+  }
+
+  void find_many(sorted_unique_t, std::span<const Key> keys, std::span<iterator> results)
+  {
+    check_batch_size(keys.size(), results.size());
+    locate_many(keys, std::identity{}, [results](std::size_t index, tree_node* node) { results[index] = iterator{ node }; });
+  }
+
+  void contains_many(std::span<const Key> keys, std::span<bool> results)
+  {
+    check_batch_size(keys.size(), results.size());
+    locate_many(keys, [this, results](std::size_t index, tree_node* node) { results[index] = node != &end_; });
+  }
+
+  void contains_many(sorted_unique_t, std::span<const Key> keys, std::span<bool> results)
+  {
+    check_batch_size(keys.size(), results.size());
+    locate_many(keys, std::identity{}, [this, results](std::size_t index, tree_node* node) { results[index] = node != &end_; });
+  }
+
+  template<std::size_t GroupSize = 8>
+  void find_many(std::span<const Key> keys, std::span<const_iterator> results) const
+  {
+    check_batch_size(keys.size(), results.size());
+    interleaved_locate<GroupSize>(keys, [results](std::size_t index, tree_node* node) { results[index] = const_iterator{ node }; });
+  }
+
+  template<std::size_t GroupSize = 8>
+  void contains_many(std::span<const Key> keys, std::span<bool> results) const
+  {
+    check_batch_size(keys.size(), results.size());
+    interleaved_locate<GroupSize>(keys, [this, results](std::size_t index, tree_node* node) { results[index] = node != &end_; });
+  }
+
+  std::pair<iterator, iterator> equal_range(const Key& key) noexcept
+  {
+    auto located = access(key);
+
+    return { iterator{ lower_bound_node(located, key) }, iterator{ upper_bound_node(located, key) } };
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(const Key& key) const noexcept
+  {
+    auto located = locate(key);
+
+    return { const_iterator{ lower_bound_node(located, key) }, const_iterator{ upper_bound_node(located, key) } };
+  }
+
+  bool contains(const Key& key) noexcept
+  {
+    return access(key).second;
+  }
+
+  bool contains(const Key& key) const noexcept
+  {
+    return locate(key).second;
+  }
+
+  std::size_t count(const Key& key) noexcept
+  {
+    return access(key).second ? 1 : 0;
+  }
+
+  std::size_t count(const Key& key) const noexcept
+  {
+    return locate(key).second ? 1 : 0;
+  }
+
+  iterator nth(std::size_t index) noexcept requires Augmentation::maintains_size
+  {
+    tree_node* target_node = find_nth(index);
+
+    if (target_node != &end_)
+    {
+      policy_splay(target_node);
+    }
+
+    return iterator{ target_node };
+  }
+
+  const_iterator nth(std::size_t index) const noexcept requires Augmentation::maintains_size
+  {
+    return const_iterator{ find_nth(index) };
+  }
+
+  std::size_t rank(const Key& key) noexcept requires Augmentation::maintains_size
+  {
+    return index_of(lower_bound_node(access(key), key));
+  }
+
+  std::size_t rank(const Key& key) const noexcept requires Augmentation::maintains_size
+  {
+    return index_of(lower_bound_node(locate(key), key));
+  }
+
+  std::size_t count_range(const Key& low, const Key& high) noexcept requires Augmentation::maintains_size
+  {
+    if (!compare(low, high))
+    {
+      return 0;
+    }
+
+    std::size_t low_rank = rank(low);
+    return rank(high) - low_rank;
+  }
+
+  std::size_t count_range(const Key& low, const Key& high) const noexcept requires Augmentation::maintains_size
+  {
+    return compare(low, high) ? rank(high) - rank(low) : 0;
+  }
+
+  auto aggregate() const noexcept requires requires { typename Augmentation::monoid_type; }
+  {
+    using monoid = typename Augmentation::monoid_type;
+
+    return root_ ? root_->augmentation_.value : monoid::identity();
+  }
+
+  auto aggregate(const Key& low, const Key& high) requires requires { typename Augmentation::monoid_type; }
+  {
+    using monoid = typename Augmentation::monoid_type;
+    auto result = monoid::identity();
+
+    if (root_ != nullptr && compare(low, high))
+    {
+      visit_range(low, high, [&result](tree_node* range_root)
+      {
+        if (range_root)
+        {
+          result = range_root->augmentation_.value;
+        }
+      });
+    }
+
+    return result;
+  }
+
+  template<class Lazy = Augmentation>
+  void apply_range(const Key& low, const Key& high, const typename Lazy::tag_type& tag) requires Augmentation::is_lazy
+  {
+    if (root_ == nullptr || !compare(low, high))
+    {
+      return;
+    }
+
+    bool touches_begin = !compare(begin_->get_pair().first, low);
+    bool touches_max = compare(end_.parent_->get_pair().first, high);
+
+    visit_range(low, high, [&tag](tree_node* range_root)
+    {
+      if (range_root)
+      {
+        Augmentation::apply(range_root->augmentation_, range_root->get_pair(), tag);
+      }
+    });
 
-    if (grandparent)
+    // begin_ and the maximum are reached without a descent, so their pending tags are resolved eagerly.
+    if (touches_begin)
     {
-      if (grandparent->left_ == sub_tree_root) grandparent->left_ = target_node;
-      else grandparent->right_ = target_node;
+      root_ = splay_top_down(root_, begin_->get_pair().first).first;
     }
-    else
+
+    if (touches_max)
     {
-      root_ = target_node;
+      root_ = splay_top_down(root_, end_.parent_->get_pair().first).first;
     }
   }
 
-  void splay(tree_node* target_node) noexcept
+  auto aggregate(const Key& low, const Key& high) const requires requires { typename Augmentation::monoid_type; }
   {
-    while (target_node->parent_ != nullptr)
+    using monoid = typename Augmentation::monoid_type;
+    auto node_value = [this](const tree_node* node) { return is_data_node(node) ? node->augmentation_.value : monoid::identity(); };
+    tree_node* split_node = root_;
+
+    if (!compare(low, high))
     {
-      tree_node* parent = target_node->parent_;
-      tree_node* grandparent = parent->parent_;
+      return monoid::identity();
+    }
 
-      if (grandparent == nullptr)
+    while (is_data_node(split_node))
+    {
+      push(split_node);
+
+      if (compare(split_node->get_pair().first, low))
       {
-        if (parent->left_ == target_node)
-        {
-          zig(target_node);
-        }
-        else
-        {
-          zag(target_node);
-        }
+        split_node = split_node->right_;
       }
-      else if (grandparent->left_ == parent && parent->left_ == target_node)
+      else if (!compare(split_node->get_pair().first, high))
       {
-        zig_zig(parent);
+        split_node = split_node->left_;
       }
-      else if (grandparent->right_ == parent && parent->right_ == target_node)
+      else
       {
-        zag_zag(parent);
+        break;
       }
-      else if (grandparent->right_ == parent && parent->left_ == target_node)
+    }
+
+    if (!is_data_node(split_node))
+    {
+      return monoid::identity();
+    }
+
+    auto left_value = monoid::identity();
+    auto right_value = monoid::identity();
+
+    for (tree_node* current_node = split_node->left_; current_node != nullptr;)
+    {
+      push(current_node);
+
+      if (compare(current_node->get_pair().first, low))
       {
-        zig_zag(parent);
+        current_node = current_node->right_;
       }
       else
       {
-        zag_zig(parent);
+        left_value = monoid::combine(monoid::combine(Augmentation::lift(current_node->get_pair()), node_value(current_node->right_)), left_value);
+        current_node = current_node->left_;
       }
     }
-  }
-
-public:
-  splay_tree() : node_allocator_{}, comparator_{}
-  {}
 
-  splay_tree(std::initializer_list<value_type> list, const Comparator& comp = Comparator{}, const Allocator& alloc = Allocator{})
-    : node_allocator_{ alloc }, comparator_{ comp }
-  {
-    insert(list);
-  }
+    for (tree_node* current_node = split_node->right_; is_data_node(current_node);)
+    {
+      push(current_node);
 
-  template<std::input_iterator It>
-  splay_tree(It begin, It end, const Comparator& comp = Comparator{}, const Allocator& alloc = Allocator{})
-    : node_allocator_{ alloc }, comparator_{ comp }
-  {
-    insert(begin, end);
-  }
+      if (compare(current_node->get_pair().first, high))
+      {
+        right_value = monoid::combine(right_value, monoid::combine(node_value(current_node->left_), Augmentation::lift(current_node->get_pair())));
+        current_node = current_node->right_;
+      }
+      else
+      {
+        current_node = current_node->left_;
+      }
+    }
 
-  splay_tree(const splay_tree& obj)
-    : node_allocator_{ obj.node_allocator_ }, comparator_{ obj.comparator_ }
-  {
-    insert(obj.begin(), obj.end());
+    return monoid::combine(monoid::combine(left_value, Augmentation::lift(split_node->get_pair())), right_value);
   }
 
-  splay_tree(splay_tree&& obj) noexcept
+  difference_type distance(const_iterator first, const_iterator last) const noexcept requires Augmentation::maintains_size
   {
-    swap(obj);
+    return static_cast<difference_type>(index_of(last.it_.node_)) - static_cast<difference_type>(index_of(first.it_.node_));
   }
 
-  splay_tree& operator=(const splay_tree& obj)
+  template<class SplayTree>
+  void merge(SplayTree&& obj)
   {
-    if (&obj == this)
+    if (obj.root_ == nullptr || &obj == this)
     {
-      return *this;
+      return;
     }
 
-    splay_tree{ obj }.swap(*this);
+    if constexpr (!std::allocator_traits<node_allocator_type>::is_always_equal::value)
+    {
+      // Nodes cannot change hands between unequal allocators (e.g. slab trees with separate pools), so copy them.
+      if (node_allocator_ != obj.node_allocator_)
+      {
+        for (auto& [key, value] : obj)
+        {
+          emplace(key, std::move(value));
+        }
 
-    return *this;
+        obj.clear();
+        return;
+      }
+    }
+
+    if (root_ == nullptr)
+    {
+      root_ = obj.root_;
+      begin_ = obj.begin_;
+      end_.parent_ = obj.end_.parent_;
+      end_.parent_->right_ = &end_;
+      tree_size_ = obj.tree_size_;
+      obj.release_nodes();
+    }
+    else if (compare(end_.parent_->get_pair().first, obj.begin_->get_pair().first))
+    {
+      join_greater(obj);
+    }
+    else if (compare(obj.end_.parent_->get_pair().first, begin_->get_pair().first))
+    {
+      join_less(obj);
+    }
+    else
+    {
+      merge_vines(obj);
+    }
   }
 
-  splay_tree& operator=(splay_tree&& obj)
+  // Relinks in amortized O(log n). Without a size-maintaining augmentation the new sizes are recounted by walking
+  // both halves in lockstep until the smaller one ends, which adds O(min(k, n - k)) for a split into k and n - k.
+  splay_tree split(const Key& key)
   {
-    if (&obj == this)
+    splay_tree result = empty_sibling();
+    finger_ = nullptr;
+
+    if (root_ == nullptr)
     {
-      return *this;
+      return result;
     }
 
-    swap(obj);
+    tree_node* max_node = end_.parent_;
+    max_node->right_ = nullptr;
 
-    return *this;
-  }
+    auto [left_part, right_part] = split_sub_tree(root_, key);
 
-  ~splay_tree() noexcept
-  {
-    clear();
-  }
+    if (right_part == nullptr)
+    {
+      root_ = left_part;
+      max_node->right_ = &end_;
 
-  Data& at(const Key& key)
-  {
-    auto result = find(key);
+      return result;
+    }
 
-    if (result.node_ == &end_)
+    right_part = splay_top_down(right_part, key).first;
+    std::size_t left_size = 0;
+
+    if (left_part != nullptr)
     {
-      throw std::out_of_range{ "splay_tree: key was out of range." };
+      left_part = splay_top_down(left_part, key).first;
+      left_size = left_part_size(left_part, right_part);
     }
 
-    return result->second;
-  }
-
-  iterator find(const Key& key) noexcept
-  {
-    auto [target_node, prev_node] = find_internal(key);
+    result.root_ = right_part;
+    result.begin_ = right_part;
+    result.end_.parent_ = max_node;
+    max_node->right_ = &result.end_;
+    result.tree_size_ = tree_size_ - left_size;
 
-    if (target_node == nullptr || target_node == &end_)
+    if (left_part == nullptr)
     {
-      target_node = &end_;
-
-      if (prev_node)
-      {
-        splay(prev_node);
-      }
+      release_nodes();
     }
     else
     {
-      splay(target_node);
+      root_ = left_part;
+      end_.parent_ = left_part;
+      left_part->right_ = &end_;
+      tree_size_ = left_size;
     }
 
-    return iterator{ target_node };
+    return result;
   }
 
   template<class SplayTree>
-  void merge(SplayTree&& obj)
+  void join(SplayTree&& obj)
   {
-    if (obj.root_ == nullptr)
+    if (obj.root_ == nullptr || &obj == this)
     {
       return;
     }
 
-    std::queue<tree_node*> node_queue;
-    node_queue.push(obj.root_);
-    if (obj.end_.parent_)
+    if (root_ != nullptr && !compare(end_.parent_->get_pair().first, obj.begin_->get_pair().first)
+      && !compare(obj.end_.parent_->get_pair().first, begin_->get_pair().first))
     {
-      obj.end_.parent_->right_ = nullptr;
-      obj.end_.parent_ = nullptr;
+      throw std::invalid_argument{ "splay_tree: joined trees have overlapping keys." };
     }
 
-    while (!node_queue.empty())
+    // join promises to relink nodes, which merge can only do between equal allocators.
+    if constexpr (!std::allocator_traits<node_allocator_type>::is_always_equal::value)
     {
-      tree_node* current_node = node_queue.front();
-      node_queue.pop();
-
-      if (current_node->right_) node_queue.push(current_node->right_);
-      if (current_node->left_) node_queue.push(current_node->left_);
-
-      current_node->left_ = nullptr;
-      current_node->right_ = nullptr;
-
-      insert_node(current_node);
+      if (node_allocator_ != obj.node_allocator_)
+      {
+        throw std::invalid_argument{ "splay_tree: joined trees have unequal allocators." };
+      }
     }
 
-    obj.begin_ = &obj.end_;
-    obj.root_ = nullptr;
-    obj.tree_size_ = 0;
+    merge(std::forward<SplayTree>(obj));
   }
 
   void swap(splay_tree& obj) noexcept
   {
-    if (begin_ == &end_)
-    {
-      begin_ = &obj.end_;
-    }
-
-    if (obj.begin_ == &obj.end_)
-    {
-      obj.begin_ = &end_;
-    }
-
     std::swap(node_allocator_, obj.node_allocator_);
     std::swap(comparator_, obj.comparator_);
-    std::swap(end_, obj.end_);
+    std::swap(splay_policy_, obj.splay_policy_);
+    std::swap(stats_, obj.stats_);
+    std::swap(end_.parent_, obj.end_.parent_);
     std::swap(root_, obj.root_);
     std::swap(begin_, obj.begin_);
+    std::swap(finger_, obj.finger_);
     std::swap(tree_size_, obj.tree_size_);
+
+    rewire_end();
+    obj.rewire_end();
   }
 
   Data& operator[](const Key& key)
@@ -848,6 +3098,52 @@ public:
     const auto& key = internal::extract_key(std::forward<Args>(args)...);
     std::pair<iterator, bool> result = {};
 
+    if constexpr (SplayPolicy::is_top_down)
+    {
+      if (root_ != nullptr)
+      {
+        auto [new_root, found] = splay_top_down(root_, key);
+        root_ = new_root;
+
+        if (found)
+        {
+          return { iterator{ root_ }, false };
+        }
+
+        new_node = allocate_and_construct_node_emplace(std::forward<Args>(args)...);
+
+        if (compare(key, root_->get_pair().first))
+        {
+          new_node->left_ = root_->left_;
+          new_node->right_ = root_;
+          root_->left_ = nullptr;
+        }
+        else
+        {
+          new_node->right_ = root_->right_;
+          new_node->left_ = root_;
+          root_->right_ = nullptr;
+        }
+
+        if (new_node->left_)
+        {
+          new_node->left_->parent_ = new_node;
+        }
+        else
+        {
+          begin_ = new_node;
+        }
+
+        new_node->right_->parent_ = new_node;
+        update(root_);
+        update(new_node);
+        root_ = new_node;
+        ++tree_size_;
+
+        return { iterator{ new_node }, true };
+      }
+    }
+
     auto [target_node, prev_node] = find_internal(key);
 
     if (target_node == nullptr && prev_node == nullptr)
@@ -868,7 +3164,7 @@ public:
     }
     else
     {
-      tree_node** where_to_place_ptr = comparator_(key, prev_node->get_pair().first)
+      tree_node** where_to_place_ptr = compare(key, prev_node->get_pair().first)
         ? &prev_node->left_ : &prev_node->right_;
       new_node = allocate_and_construct_node_emplace(std::forward<Args>(args)...);
 
@@ -878,7 +3174,7 @@ public:
         end_.parent_ = new_node;
       }
 
-      if (comparator_(new_node->get_pair().first, begin_->get_pair().first))
+      if (compare(new_node->get_pair().first, begin_->get_pair().first))
       {
         begin_ = new_node;
       }
@@ -889,21 +3185,119 @@ public:
       ++tree_size_;
     }
 
-    splay(new_node);
+    policy_splay(new_node);
     result.first = iterator{ new_node };
 
     return result;
   }
 
+  template<class... Args>
+  iterator emplace_hint(const_iterator hint, Args&&... args)
+  {
+    const auto& key = internal::extract_key(std::forward<Args>(args)...);
+    tree_node* hint_node = hint.it_.node_;
+    tree_node* parent = nullptr;
+    bool as_left_child = false;
+
+    // A pending range tag above the hint would later reach the new node too, so lazy trees take the regular path.
+    if (root_ == nullptr || Augmentation::is_lazy)
+    {
+      return emplace(std::forward<Args>(args)...).first;
+    }
+
+    if (hint_node == &end_ || compare(key, hint_node->get_pair().first))
+    {
+      if (hint_node == begin_)
+      {
+        parent = begin_;
+        as_left_child = true;
+      }
+      else
+      {
+        tree_node* prev_node = std::prev(iterator{ hint_node }).node_;
+
+        if (compare(prev_node->get_pair().first, key))
+        {
+          as_left_child = hint_node->left_ == nullptr && hint_node != &end_;
+          parent = as_left_child ? hint_node : prev_node;
+        }
+      }
+    }
+    else if (compare(hint_node->get_pair().first, key))
+    {
+      tree_node* next_node = std::next(iterator{ hint_node }).node_;
+
+      if (next_node == &end_ || compare(key, next_node->get_pair().first))
+      {
+        as_left_child = is_data_node(hint_node->right_);
+        parent = as_left_child ? next_node : hint_node;
+      }
+    }
+    else
+    {
+      policy_splay(hint_node);
+      return iterator{ hint_node };
+    }
+
+    if (parent == nullptr)
+    {
+      return emplace(std::forward<Args>(args)...).first;
+    }
+
+    tree_node** where_to_place_ptr = as_left_child ? &parent->left_ : &parent->right_;
+    tree_node* new_node = allocate_and_construct_node_emplace(std::forward<Args>(args)...);
+
+    if (*where_to_place_ptr == &end_)
+    {
+      new_node->right_ = &end_;
+      end_.parent_ = new_node;
+    }
+
+    if (as_left_child && parent == begin_)
+    {
+      begin_ = new_node;
+    }
+
+    new_node->parent_ = parent;
+    *where_to_place_ptr = new_node;
+    ++tree_size_;
+    policy_splay(new_node);
+
+    return iterator{ new_node };
+  }
+
+  template<class Pair>
+  iterator insert(const_iterator hint, Pair&& data)
+  {
+    return emplace_hint(hint, data.first, data.second);
+  }
+
   template<std::input_iterator It>
   void insert(It begin, It end)
   {
+    if constexpr (std::forward_iterator<It>)
+    {
+      auto is_unsorted = [this](const auto& lhs, const auto& rhs) { return !compare(lhs.first, rhs.first); };
+
+      if (std::adjacent_find(begin, end, is_unsorted) == end)
+      {
+        insert_sorted(begin, end, static_cast<std::size_t>(std::distance(begin, end)));
+        return;
+      }
+    }
+
     for (; begin != end; ++begin)
     {
       insert(*begin);
     }
   }
 
+  template<std::forward_iterator It>
+  void insert(sorted_unique_t, It begin, It end)
+  {
+    insert_sorted(begin, end, static_cast<std::size_t>(std::distance(begin, end)));
+  }
+
   template<std::ranges::input_range Range>
   void insert(Range&& range)
   {
@@ -918,10 +3312,9 @@ public:
 
   iterator erase(iterator begin, iterator end) noexcept
   {
-    while (begin != end)
+    if (begin != end)
     {
-      iterator temp = begin++;
-      erase_internal(temp.node_);
+      erase_key_range(begin->first, end.node_ == &end_ ? nullptr : &end->first);
     }
 
     return end;
@@ -937,6 +3330,24 @@ public:
 
   bool erase(const Key& key) noexcept
   {
+    if constexpr (SplayPolicy::is_top_down)
+    {
+      if (root_ == nullptr)
+      {
+        return false;
+      }
+
+      auto [new_root, found] = splay_top_down(root_, key);
+      root_ = new_root;
+
+      if (found)
+      {
+        remove_root();
+      }
+
+      return found;
+    }
+
     auto resulted_pair = find(key);
 
     if (resulted_pair.node_ == &end_)
@@ -948,6 +3359,11 @@ public:
     return true;
   }
 
+  std::size_t erase(const Key& low, const Key& high) noexcept
+  {
+    return erase_key_range(low, &high);
+  }
+
   void clear()
   {
     if (root_ == nullptr)
@@ -955,25 +3371,25 @@ public:
       return;
     }
 
-    std::queue<tree_node*> node_queue;
-    node_queue.push(root_);
     end_.parent_->right_ = nullptr;
+    destroy_sub_tree(root_);
+    release_nodes();
+  }
 
-    while (!node_queue.empty())
+  void reserve(std::size_t count)
+  {
+    if constexpr (requires { node_allocator_.reserve(count); })
     {
-      tree_node* current_node = node_queue.front();
-      node_queue.pop();
-
-      if (current_node->right_) node_queue.push(current_node->right_);
-      if (current_node->left_) node_queue.push(current_node->left_);
-
-      std::destroy_at(static_cast<data_node*>(current_node));
-      node_allocator_.deallocate(static_cast<data_node*>(current_node), 1);
+      if (count > tree_size_)
+      {
+        node_allocator_.reserve(count - tree_size_);
+      }
     }
+  }
 
-    tree_size_ = 0;
-    root_ = nullptr;
-    begin_ = &end_;
+  allocator_type get_allocator() const noexcept
+  {
+    return allocator_type{ node_allocator_ };
   }
 
   [[nodiscard]] bool empty() const noexcept
@@ -986,6 +3402,16 @@ public:
     return tree_size_;
   }
 
+  [[nodiscard]] const Stats& stats() const noexcept
+  {
+    return stats_;
+  }
+
+  void reset_stats() noexcept
+  {
+    stats_ = Stats{};
+  }
+
   iterator begin() noexcept
   {
     return iterator{ begin_ };
@@ -1,7 +1,16 @@
 #include <gtest/gtest.h>
 #include "splay_tree.hpp"
+#include "sharded_splay_tree.hpp"
+#include "flat_combining_splay_tree.hpp"
+#include "deferred_splay_tree.hpp"
+#include "cow_splay_tree.hpp"
+#include "compact_splay_tree.hpp"
 #include <array>
 #include <random>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <string>
 
 TEST(insert_test, insert_operator)
 {
@@ -330,3 +339,1981 @@ TEST(custom_comparator_test, greater_comparator)
     EXPECT_NE(map.find(j), map.end());
   }
 }
+
+template<class SplayTree>
+void run_random_operations_against_std_map()
+{
+  SplayTree map;
+  std::map<int, int> reference;
+
+  for (int j = 0; j < 5000; j++)
+  {
+    int key = static_cast<int>(random_int(2000));
+
+    switch (random_int(3))
+    {
+    case 0:
+      EXPECT_EQ(map.emplace(key, j).second, reference.emplace(key, j).second);
+      break;
+    case 1:
+      EXPECT_EQ(map.erase(key), reference.erase(key) == 1);
+      break;
+    default:
+      EXPECT_EQ(map.find(key) == map.end(), reference.find(key) == reference.end());
+      break;
+    }
+  }
+
+  EXPECT_EQ(map.size(), reference.size());
+  EXPECT_TRUE(std::ranges::equal(map, reference));
+  EXPECT_TRUE(std::ranges::equal(map | std::views::reverse, reference | std::views::reverse));
+}
+
+TEST(splay_policy_test, top_down)
+{
+  run_random_operations_against_std_map<splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, splay_policy::top_down>>();
+}
+
+TEST(splay_policy_test, bottom_up)
+{
+  run_random_operations_against_std_map<splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, splay_policy::bottom_up>>();
+}
+
+TEST(slab_allocator_test, freed_nodes_are_recycled)
+{
+  slab_allocator<std::pair<const int, int>> allocator;
+
+  auto* first = allocator.allocate(1);
+  auto* second = allocator.allocate(1);
+  EXPECT_NE(first, second);
+
+  allocator.deallocate(first, 1);
+  EXPECT_EQ(allocator.allocate(1), first);
+
+  allocator.deallocate(first, 1);
+  allocator.deallocate(second, 1);
+}
+
+TEST(slab_allocator_test, copies_and_rebinds_share_the_pool)
+{
+  using pair_allocator = slab_allocator<std::pair<const int, int>>;
+  pair_allocator allocator;
+  slab_allocator<double> rebound{ allocator };
+  pair_allocator round_trip{ rebound };
+
+  EXPECT_TRUE(rebound == allocator);
+  EXPECT_TRUE(round_trip == allocator);
+  EXPECT_TRUE(pair_allocator{ allocator } == allocator);
+  EXPECT_FALSE(pair_allocator{} == allocator);
+  EXPECT_FALSE(allocator.select_on_container_copy_construction() == allocator);
+
+  auto* first = allocator.allocate(1);
+  round_trip.deallocate(first, 1);
+  EXPECT_EQ(allocator.allocate(1), first);
+  allocator.deallocate(first, 1);
+}
+
+TEST(slab_allocator_test, tree_with_slab_allocator)
+{
+  using slab_tree = splay_tree<int, int, std::less<int>, slab_allocator<std::pair<const int, int>>>;
+  run_random_operations_against_std_map<slab_tree>();
+
+  slab_tree map;
+  map.reserve(1000);
+
+  for (int j = 0; j < 1000; j++)
+  {
+    map.emplace(j, j);
+  }
+
+  slab_tree map_copy(map);
+  map.clear();
+
+  EXPECT_EQ(map_copy.size(), 1000);
+  EXPECT_EQ(map_copy.at(999), 999);
+}
+
+template<class T>
+struct counting_allocator
+{
+  using value_type = T;
+  using is_always_equal = std::false_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  std::shared_ptr<std::size_t> allocations = std::make_shared<std::size_t>(0);
+  std::shared_ptr<int> identity = std::make_shared<int>();
+  bool separate_copies = false;
+
+  counting_allocator() = default;
+
+  template<class U>
+  counting_allocator(const counting_allocator<U>& obj) noexcept
+    : allocations{ obj.allocations }, identity{ obj.identity }, separate_copies{ obj.separate_copies }
+  {}
+
+  // With separate_copies, containers copied from this allocator compare unequal to it but share the counter.
+  counting_allocator select_on_container_copy_construction() const
+  {
+    counting_allocator result = *this;
+
+    if (separate_copies)
+    {
+      result.identity = std::make_shared<int>();
+    }
+
+    return result;
+  }
+
+  T* allocate(std::size_t count)
+  {
+    ++*allocations;
+    return std::allocator<T>{}.allocate(count);
+  }
+
+  void deallocate(T* ptr, std::size_t count) noexcept
+  {
+    std::allocator<T>{}.deallocate(ptr, count);
+  }
+
+  template<class U>
+  bool operator==(const counting_allocator<U>& obj) const noexcept
+  {
+    return identity == obj.identity;
+  }
+};
+
+using counting_tree = splay_tree<int, int, std::less<int>, counting_allocator<std::pair<const int, int>>>;
+
+TEST(tree_merging, merging_of_overlapping_trees)
+{
+  splay_tree<int, int> map1;
+  splay_tree<int, int> map2;
+  std::map<int, int> reference;
+
+  for (int j = 0; j < 2000; j++)
+  {
+    int key = static_cast<int>(random_int(3000));
+    map1.emplace(key, 1);
+    reference.emplace(key, 1);
+  }
+
+  for (int j = 0; j < 2000; j++)
+  {
+    int key = static_cast<int>(random_int(3000));
+    map2.emplace(key, 2);
+    reference.emplace(key, 2);
+  }
+
+  map1.merge(map2);
+
+  EXPECT_TRUE(map2.empty());
+  EXPECT_EQ(map2.begin(), map2.end());
+  EXPECT_EQ(map1.size(), reference.size());
+  EXPECT_TRUE(std::ranges::equal(map1, reference));
+  EXPECT_TRUE(std::ranges::equal(map1 | std::views::reverse, reference | std::views::reverse));
+
+  map1.emplace(-1, 0);
+  map1.emplace(5000, 0);
+  EXPECT_EQ(map1.begin()->first, -1);
+  EXPECT_EQ((--map1.end())->first, 5000);
+}
+
+TEST(tree_merging, merging_of_disjoint_trees_in_both_orders)
+{
+  splay_tree<int, int> low = { {1, 1}, {2, 2}, {3, 3} };
+  splay_tree<int, int> high = { {10, 10}, {20, 20}, {30, 30} };
+  splay_tree<int, int> lower = { {-3, -3}, {-2, -2} };
+
+  low.merge(high);
+  low.merge(lower);
+
+  std::array<int, 8> expected{ -3, -2, 1, 2, 3, 10, 20, 30 };
+  EXPECT_TRUE(std::ranges::equal(low | std::views::keys, expected));
+  EXPECT_TRUE(std::ranges::equal(low | std::views::keys | std::views::reverse, expected | std::views::reverse));
+  EXPECT_EQ(low.size(), expected.size());
+  EXPECT_TRUE(high.empty());
+  EXPECT_TRUE(lower.empty());
+}
+
+TEST(tree_merging, merging_of_trees_with_different_pools)
+{
+  using slab_tree = splay_tree<int, int, std::less<int>, slab_allocator<std::pair<const int, int>>>;
+  slab_tree map1 = { {1, 1}, {3, 3} };
+  slab_tree map2 = { {2, 2}, {3, 4} };
+
+  map1.merge(map2);
+
+  EXPECT_TRUE(map2.empty());
+  EXPECT_EQ(map1.size(), 3);
+  EXPECT_EQ(map1.at(3), 3);
+}
+
+TEST(tree_merging, merging_with_equal_allocators_relinks_nodes)
+{
+  counting_allocator<std::pair<const int, int>> allocator;
+  counting_tree map1{ allocator };
+  counting_tree map2{ allocator };
+
+  for (int j = 0; j < 1000; j++)
+  {
+    map1.emplace(j * 2, 1);
+    map2.emplace(j * 3, 2);
+  }
+
+  std::size_t allocations = *allocator.allocations;
+  map1.merge(map2);
+
+  EXPECT_EQ(*allocator.allocations, allocations);
+  EXPECT_EQ(map1.size(), 1000 + 1000 - 334);
+  EXPECT_TRUE(map2.empty());
+  EXPECT_EQ(map1.at(2997), 2);
+  EXPECT_EQ(map1.at(6), 1);
+}
+
+TEST(tree_merging, merging_of_trees_sharing_a_pool)
+{
+  using slab_tree = splay_tree<int, int, std::less<int>, slab_allocator<std::pair<const int, int>>>;
+  slab_allocator<std::pair<const int, int>> pool;
+  slab_tree map1{ pool };
+  slab_tree map2{ pool };
+  map1.emplace(1, 1);
+  map2.emplace(2, 2);
+  const int* moved_value = &map2.at(2);
+
+  map1.merge(map2);
+
+  EXPECT_EQ(map1.get_allocator(), map2.get_allocator());
+  EXPECT_TRUE(map2.empty());
+  EXPECT_EQ(&map1.at(2), moved_value);
+}
+
+TEST(bulk_construction_test, sorted_input_builds_balanced_tree)
+{
+  std::vector<std::pair<int, int>> v;
+
+  for (int j = 0; j < 10000; j++)
+  {
+    v.emplace_back(j * 2, j);
+  }
+
+  splay_tree<int, int> map(v.begin(), v.end());
+  splay_tree<int, int> tagged_map(sorted_unique, v.begin(), v.end());
+
+  EXPECT_EQ(map.size(), v.size());
+  EXPECT_EQ(tagged_map.size(), v.size());
+  EXPECT_TRUE(std::ranges::equal(map | std::views::keys, v | std::views::keys));
+  EXPECT_TRUE(std::ranges::equal(tagged_map | std::views::keys | std::views::reverse, v | std::views::keys | std::views::reverse));
+  EXPECT_EQ(map.at(19998), 9999);
+  EXPECT_EQ(tagged_map.find(3), tagged_map.end());
+}
+
+TEST(bulk_construction_test, sorted_insert_into_non_empty_tree)
+{
+  splay_tree<int, int> map = { {5, 0}, {1000, 0} };
+  std::vector<std::pair<int, int>> v;
+
+  for (int j = 0; j < 100; j++)
+  {
+    v.emplace_back(j * 10, j);
+  }
+
+  map.insert(v.begin(), v.end());
+  map.insert(sorted_unique, v.begin(), v.end());
+
+  std::map<int, int> reference = { {5, 0}, {1000, 0} };
+  reference.insert(v.begin(), v.end());
+
+  EXPECT_EQ(map.size(), reference.size());
+  EXPECT_TRUE(std::ranges::equal(map, reference));
+}
+
+TEST(bulk_construction_test, unsorted_input_falls_back_to_insertion)
+{
+  std::vector<std::pair<int, int>> v = { {3, 3}, {1, 1}, {2, 2}, {1, 5} };
+  splay_tree<int, int> map(v.begin(), v.end());
+
+  std::array<std::pair<const int, int>, 3> expected{ std::pair{1, 1}, {2, 2}, {3, 3} };
+  EXPECT_TRUE(std::ranges::equal(map, expected));
+}
+
+struct throwing_on_copy
+{
+  static inline int copies_left = 0;
+  int value = 0;
+
+  throwing_on_copy(int v) : value{ v }
+  {}
+
+  throwing_on_copy(const throwing_on_copy& obj) : value{ obj.value }
+  {
+    if (--copies_left < 0)
+    {
+      throw std::runtime_error{ "copy failed" };
+    }
+  }
+};
+
+TEST(constructors_test, copy_constructor_keeps_structure)
+{
+  splay_tree<int, int> map1;
+
+  for (int j = 0; j < 100000; j++)
+  {
+    map1.emplace(j, j);
+  }
+
+  map1.find(50000);
+  splay_tree<int, int> map2(map1);
+  splay_tree<int, int> map3(map1, rebalanced_copy);
+
+  EXPECT_EQ(map2.size(), map1.size());
+  EXPECT_EQ(map3.size(), map1.size());
+  EXPECT_TRUE(std::ranges::equal(map1, map2));
+  EXPECT_TRUE(std::ranges::equal(map1 | std::views::reverse, map3 | std::views::reverse));
+
+  map2.emplace(-1, -1);
+  map2.erase(99999);
+  EXPECT_EQ(map2.begin()->first, -1);
+  EXPECT_EQ((--map2.end())->first, 99998);
+  EXPECT_EQ(map1.size(), 100000);
+}
+
+TEST(constructors_test, copy_constructor_exception_safety)
+{
+  splay_tree<int, throwing_on_copy> map1;
+
+  for (int j = 0; j < 100; j++)
+  {
+    map1.emplace(j, j);
+  }
+
+  throwing_on_copy::copies_left = 50;
+  using throwing_tree = splay_tree<int, throwing_on_copy>;
+  EXPECT_THROW(throwing_tree{ map1 }, std::runtime_error);
+
+  throwing_on_copy::copies_left = 100;
+  splay_tree<int, throwing_on_copy> map2(map1);
+  EXPECT_EQ(map2.size(), 100);
+}
+
+template<class SplayTree>
+void run_ordered_search_against_std_map()
+{
+  SplayTree map;
+  std::map<int, int> reference;
+
+  for (int j = 0; j < 500; j++)
+  {
+    int key = static_cast<int>(random_int(2000)) * 2;
+    map.emplace(key, j);
+    reference.emplace(key, j);
+  }
+
+  auto to_key = [](auto it, auto end) { return it == end ? -1 : it->first; };
+
+  for (int j = 0; j < 2000; j++)
+  {
+    int key = static_cast<int>(random_int(4200)) - 100;
+
+    EXPECT_EQ(to_key(map.lower_bound(key), map.end()), to_key(reference.lower_bound(key), reference.end()));
+    EXPECT_EQ(to_key(map.upper_bound(key), map.end()), to_key(reference.upper_bound(key), reference.end()));
+
+    auto [first, last] = map.equal_range(key);
+    auto [reference_first, reference_last] = reference.equal_range(key);
+    EXPECT_EQ(to_key(first, map.end()), to_key(reference_first, reference.end()));
+    EXPECT_EQ(to_key(last, map.end()), to_key(reference_last, reference.end()));
+
+    EXPECT_EQ(map.contains(key), reference.contains(key));
+    EXPECT_EQ(map.count(key), reference.count(key));
+  }
+
+  EXPECT_TRUE(std::ranges::equal(map, reference));
+}
+
+TEST(search_test, ordered_search_top_down)
+{
+  run_ordered_search_against_std_map<splay_tree<int, int>>();
+}
+
+TEST(search_test, ordered_search_bottom_up)
+{
+  run_ordered_search_against_std_map<splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, splay_policy::bottom_up>>();
+}
+
+TEST(search_test, ordered_search_on_empty_tree)
+{
+  splay_tree<int, int> map;
+
+  EXPECT_EQ(map.lower_bound(1), map.end());
+  EXPECT_EQ(map.upper_bound(1), map.end());
+  EXPECT_EQ(map.equal_range(1).first, map.end());
+  EXPECT_FALSE(map.contains(1));
+}
+
+TEST(search_test, const_lookups)
+{
+  splay_tree<int, int> map;
+  std::map<int, int> reference;
+
+  for (int j = 0; j < 1000; j++)
+  {
+    int key = static_cast<int>(random_int(5000));
+    map.emplace(key, j);
+    reference.emplace(key, j);
+  }
+
+  const auto& const_map = map;
+  auto to_key = [](auto it, auto end) { return it == end ? -1 : it->first; };
+
+  for (int j = -10; j < 5010; j++)
+  {
+    EXPECT_EQ(const_map.contains(j), reference.contains(j));
+    EXPECT_EQ(const_map.count(j), reference.count(j));
+    EXPECT_EQ(to_key(const_map.find(j), const_map.end()), to_key(reference.find(j), reference.end()));
+    EXPECT_EQ(to_key(const_map.lower_bound(j), const_map.end()), to_key(reference.lower_bound(j), reference.end()));
+    EXPECT_EQ(to_key(const_map.upper_bound(j), const_map.end()), to_key(reference.upper_bound(j), reference.end()));
+    EXPECT_EQ(to_key(const_map.equal_range(j).second, const_map.end()), to_key(reference.equal_range(j).second, reference.end()));
+  }
+
+  EXPECT_EQ(const_map.at(reference.begin()->first), reference.begin()->second);
+  EXPECT_THROW(const_map.at(-1), std::out_of_range);
+}
+
+TEST(search_test, concurrent_const_lookups)
+{
+  std::vector<std::pair<int, int>> v;
+
+  for (int j = 0; j < 10000; j++)
+  {
+    v.emplace_back(j, j * 3);
+  }
+
+  const splay_tree<int, int> map(v.begin(), v.end());
+  std::vector<std::thread> readers;
+  std::atomic<int> mismatches = 0;
+
+  for (int t = 0; t < 4; t++)
+  {
+    readers.emplace_back([&map, &mismatches, t]
+    {
+      for (int j = t; j < 10000; j += 2)
+      {
+        auto it = map.find(j);
+
+        if (it == map.end() || it->second != j * 3 || map.lower_bound(j)->first != j)
+        {
+          ++mismatches;
+        }
+      }
+    });
+  }
+
+  for (auto& reader : readers)
+  {
+    reader.join();
+  }
+
+  EXPECT_EQ(mismatches, 0);
+}
+
+template<class SplayPolicy>
+using policy_tree = splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, SplayPolicy>;
+
+TEST(splay_policy_test, semi_splay)
+{
+  run_random_operations_against_std_map<policy_tree<splay_policy::semi_splay>>();
+  run_ordered_search_against_std_map<policy_tree<splay_policy::semi_splay>>();
+}
+
+TEST(splay_policy_test, depth_threshold)
+{
+  run_random_operations_against_std_map<policy_tree<splay_policy::depth_threshold<>>>();
+  run_ordered_search_against_std_map<policy_tree<splay_policy::depth_threshold<3, 2>>>();
+}
+
+struct depth_recording_policy : splay_policy::bottom_up
+{
+  static inline std::vector<std::size_t> depths;
+
+  bool should_splay(std::size_t depth, std::size_t, bool)
+  {
+    depths.push_back(depth);
+    return false;
+  }
+};
+
+TEST(splay_policy_test, policy_sees_depth_of_accessed_node)
+{
+  splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, depth_recording_policy> map(sorted_unique,
+    { {1, 1}, {2, 2}, {3, 3}, {4, 4}, {5, 5}, {6, 6}, {7, 7} });
+  depth_recording_policy::depths.clear();
+
+  map.find(4);
+  map.find(2);
+  map.find(5);
+  map.find(8);
+
+  std::vector<std::size_t> expected{ 0, 1, 2, 2 };
+  EXPECT_EQ(depth_recording_policy::depths, expected);
+}
+
+TEST(splay_policy_test, every_kth)
+{
+  run_random_operations_against_std_map<policy_tree<splay_policy::every_kth<4>>>();
+  run_ordered_search_against_std_map<policy_tree<splay_policy::every_kth<4>>>();
+}
+
+TEST(splay_policy_test, probabilistic)
+{
+  run_random_operations_against_std_map<policy_tree<splay_policy::probabilistic<1, 8>>>();
+  run_ordered_search_against_std_map<policy_tree<splay_policy::probabilistic<1, 8>>>();
+}
+
+TEST(splay_policy_test, splay_on_hit)
+{
+  run_random_operations_against_std_map<policy_tree<splay_policy::splay_on_hit<>>>();
+  run_ordered_search_against_std_map<policy_tree<splay_policy::splay_on_hit<splay_policy::semi_splay>>>();
+}
+
+template<class SplayPolicy>
+void run_order_statistics_against_std_map()
+{
+  splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, SplayPolicy, splay_augmentation::order_statistics> map;
+  std::map<int, int> reference;
+
+  for (int j = 0; j < 3000; j++)
+  {
+    int key = static_cast<int>(random_int(2000));
+
+    if (random_int(3) == 0)
+    {
+      map.erase(key);
+      reference.erase(key);
+    }
+    else
+    {
+      map.emplace(key, j);
+      reference.emplace(key, j);
+    }
+  }
+
+  std::vector<int> keys;
+  std::ranges::copy(reference | std::views::keys, std::back_inserter(keys));
+
+  for (std::size_t j = 0; j < keys.size(); j += 7)
+  {
+    EXPECT_EQ(map.nth(j)->first, keys[j]);
+    EXPECT_EQ(std::as_const(map).nth(j)->first, keys[j]);
+  }
+
+  EXPECT_EQ(map.nth(keys.size()), map.end());
+
+  for (int key = -5; key < 2005; key += 3)
+  {
+    auto expected_rank = static_cast<std::size_t>(std::distance(reference.begin(), reference.lower_bound(key)));
+    EXPECT_EQ(map.rank(key), expected_rank);
+    EXPECT_EQ(std::as_const(map).rank(key), expected_rank);
+
+    auto expected_count = static_cast<std::size_t>(std::distance(reference.lower_bound(key), reference.lower_bound(key + 100)));
+    EXPECT_EQ(map.count_range(key, key + 100), expected_count);
+    EXPECT_EQ(map.distance(map.lower_bound(key), map.lower_bound(key + 100)), static_cast<std::ptrdiff_t>(expected_count));
+  }
+
+  EXPECT_EQ(map.distance(map.begin(), map.end()), static_cast<std::ptrdiff_t>(reference.size()));
+  EXPECT_EQ(map.count_range(10, 5), 0);
+}
+
+TEST(order_statistics_test, top_down)
+{
+  run_order_statistics_against_std_map<splay_policy::top_down>();
+}
+
+TEST(order_statistics_test, bottom_up)
+{
+  run_order_statistics_against_std_map<splay_policy::bottom_up>();
+}
+
+TEST(order_statistics_test, semi_splay)
+{
+  run_order_statistics_against_std_map<splay_policy::semi_splay>();
+}
+
+TEST(order_statistics_test, bulk_operations)
+{
+  using order_tree = splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, splay_policy::top_down, splay_augmentation::order_statistics>;
+  std::vector<std::pair<int, int>> v;
+
+  for (int j = 0; j < 1000; j++)
+  {
+    v.emplace_back(j * 2, j);
+  }
+
+  order_tree map(v.begin(), v.end());
+  order_tree copy(map);
+  order_tree other = { {1, 1}, {3, 3}, {5000, 0} };
+
+  map.merge(other);
+
+  EXPECT_EQ(map.rank(5000), 1002);
+  EXPECT_EQ(map.nth(2)->first, 2);
+  EXPECT_EQ(copy.nth(999)->first, 1998);
+  EXPECT_EQ(copy.rank(1000), 500);
+}
+
+struct concatenation
+{
+  using value_type = std::string;
+
+  static value_type identity()
+  {
+    return {};
+  }
+
+  static value_type combine(const value_type& lhs, const value_type& rhs)
+  {
+    return lhs + rhs;
+  }
+};
+
+template<class SplayPolicy>
+void run_aggregates_against_std_map()
+{
+  using sum_tree = splay_tree<int, long long, std::less<int>, std::allocator<std::pair<const int, long long>>, SplayPolicy,
+    splay_augmentation::aggregate<splay_monoid::sum<long long>>>;
+  using min_tree = splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, SplayPolicy,
+    splay_augmentation::aggregate<splay_monoid::min<int>>>;
+
+  sum_tree sums;
+  min_tree minimums;
+  std::map<int, int> reference;
+
+  for (int j = 0; j < 2000; j++)
+  {
+    int key = static_cast<int>(random_int(1000));
+    int value = static_cast<int>(random_int(100000)) - 50000;
+
+    if (random_int(4) == 0)
+    {
+      sums.erase(key);
+      minimums.erase(key);
+      reference.erase(key);
+    }
+    else
+    {
+      sums.emplace(key, value);
+      minimums.emplace(key, value);
+      reference.emplace(key, value);
+    }
+  }
+
+  for (int j = 0; j < 500; j++)
+  {
+    int low = static_cast<int>(random_int(1100)) - 50;
+    int high = low + static_cast<int>(random_int(300));
+
+    long long expected_sum = 0;
+    int expected_min = std::numeric_limits<int>::max();
+
+    for (auto it = reference.lower_bound(low); it != reference.end() && it->first < high; ++it)
+    {
+      expected_sum += it->second;
+      expected_min = std::min(expected_min, it->second);
+    }
+
+    EXPECT_EQ(sums.aggregate(low, high), expected_sum);
+    EXPECT_EQ(std::as_const(sums).aggregate(low, high), expected_sum);
+    EXPECT_EQ(minimums.aggregate(low, high), expected_min);
+    EXPECT_EQ(std::as_const(minimums).aggregate(low, high), expected_min);
+  }
+
+  long long total = 0;
+
+  for (const auto& [key, value] : reference)
+  {
+    total += value;
+  }
+
+  EXPECT_EQ(sums.aggregate(), total);
+  EXPECT_TRUE(std::ranges::equal(sums | std::views::keys, reference | std::views::keys));
+  EXPECT_TRUE(std::ranges::equal(minimums | std::views::reverse, reference | std::views::reverse));
+}
+
+TEST(aggregate_test, top_down)
+{
+  run_aggregates_against_std_map<splay_policy::top_down>();
+}
+
+TEST(aggregate_test, bottom_up)
+{
+  run_aggregates_against_std_map<splay_policy::bottom_up>();
+}
+
+TEST(aggregate_test, non_commutative_monoid)
+{
+  splay_tree<int, std::string, std::less<int>, std::allocator<std::pair<const int, std::string>>, splay_policy::top_down,
+    splay_augmentation::aggregate<concatenation>> map;
+
+  for (int j = 0; j < 26; j++)
+  {
+    map.emplace((j * 7) % 26, std::string(1, static_cast<char>('a' + (j * 7) % 26)));
+  }
+
+  EXPECT_EQ(map.aggregate(), "abcdefghijklmnopqrstuvwxyz");
+  EXPECT_EQ(std::as_const(map).aggregate(3, 9), "defghi");
+  EXPECT_EQ(map.aggregate(3, 9), "defghi");
+  EXPECT_EQ(map.aggregate(20, 100), "uvwxyz");
+  EXPECT_EQ(map.aggregate(9, 3), "");
+  EXPECT_EQ((--map.end())->first, 25);
+}
+
+template<class SplayPolicy>
+void run_range_updates_against_std_map()
+{
+  using add_tree = splay_tree<int, long long, std::less<int>, std::allocator<std::pair<const int, long long>>, SplayPolicy,
+    splay_augmentation::lazy_aggregate<splay_monoid::sum<long long>, splay_action::add<long long>>>;
+  using assign_tree = splay_tree<int, long long, std::less<int>, std::allocator<std::pair<const int, long long>>, SplayPolicy,
+    splay_augmentation::lazy_aggregate<splay_monoid::min<long long>, splay_action::assign<long long>>>;
+
+  add_tree sums;
+  assign_tree minimums;
+  std::map<int, long long> summed_reference;
+  std::map<int, long long> assigned_reference;
+
+  for (int j = 0; j < 3000; j++)
+  {
+    int key = static_cast<int>(random_int(1000));
+    long long value = static_cast<long long>(random_int(100000)) - 50000;
+    int low = static_cast<int>(random_int(1100)) - 50;
+    int high = low + static_cast<int>(random_int(300));
+
+    switch (random_int(5))
+    {
+    case 0:
+      sums.erase(key);
+      minimums.erase(key);
+      summed_reference.erase(key);
+      assigned_reference.erase(key);
+      break;
+    case 1:
+      sums.apply_range(low, high, value);
+      minimums.apply_range(low, high, value);
+
+      for (auto it = summed_reference.lower_bound(low); it != summed_reference.end() && it->first < high; ++it)
+      {
+        it->second += value;
+      }
+
+      for (auto it = assigned_reference.lower_bound(low); it != assigned_reference.end() && it->first < high; ++it)
+      {
+        it->second = value;
+      }
+      break;
+    case 2:
+    {
+      long long expected_sum = 0;
+      long long expected_min = std::numeric_limits<long long>::max();
+
+      for (auto it = summed_reference.lower_bound(low); it != summed_reference.end() && it->first < high; ++it)
+      {
+        expected_sum += it->second;
+      }
+
+      for (auto it = assigned_reference.lower_bound(low); it != assigned_reference.end() && it->first < high; ++it)
+      {
+        expected_min = std::min(expected_min, it->second);
+      }
+
+      EXPECT_EQ(std::as_const(sums).aggregate(low, high), expected_sum);
+      EXPECT_EQ(sums.aggregate(low, high), expected_sum);
+      EXPECT_EQ(minimums.aggregate(low, high), expected_min);
+      break;
+    }
+    case 3:
+      if (auto it = summed_reference.find(key); it != summed_reference.end())
+      {
+        EXPECT_EQ(sums.at(key), it->second);
+        EXPECT_EQ(std::as_const(minimums).at(key), assigned_reference.at(key));
+      }
+      break;
+    default:
+      sums.emplace(key, value);
+      minimums.emplace(key, value);
+      summed_reference.emplace(key, value);
+      assigned_reference.emplace(key, value);
+    }
+  }
+
+  EXPECT_TRUE(std::ranges::equal(sums, summed_reference));
+  EXPECT_TRUE(std::ranges::equal(minimums | std::views::reverse, assigned_reference | std::views::reverse));
+}
+
+TEST(range_update_test, top_down)
+{
+  run_range_updates_against_std_map<splay_policy::top_down>();
+}
+
+TEST(range_update_test, bottom_up)
+{
+  run_range_updates_against_std_map<splay_policy::bottom_up>();
+}
+
+TEST(range_update_test, semi_splay)
+{
+  run_range_updates_against_std_map<splay_policy::semi_splay>();
+}
+
+template<class Tree>
+void run_split_and_join_against_std_map()
+{
+  Tree tree;
+  std::map<int, int> reference;
+
+  for (int j = 0; j < 2000; j++)
+  {
+    int key = static_cast<int>(random_int(5000));
+    tree.emplace(key, j);
+    reference.emplace(key, j);
+  }
+
+  for (int j = 0; j < 200; j++)
+  {
+    int key = static_cast<int>(random_int(5200)) - 100;
+    Tree upper = tree.split(key);
+    auto middle = reference.lower_bound(key);
+
+    EXPECT_EQ(tree.size(), static_cast<std::size_t>(std::distance(reference.begin(), middle)));
+    EXPECT_EQ(upper.size(), static_cast<std::size_t>(std::distance(middle, reference.end())));
+    EXPECT_TRUE(std::ranges::equal(tree, std::ranges::subrange(reference.begin(), middle)));
+    EXPECT_TRUE(std::ranges::equal(upper | std::views::reverse, std::ranges::subrange(middle, reference.end()) | std::views::reverse));
+
+    if (j % 2 == 0)
+    {
+      tree.join(upper);
+    }
+    else
+    {
+      upper.join(std::move(tree));
+      tree = std::move(upper);
+    }
+
+    EXPECT_TRUE(upper.empty());
+    EXPECT_EQ(tree.size(), reference.size());
+    EXPECT_TRUE(std::ranges::equal(tree, reference));
+    EXPECT_TRUE(std::ranges::equal(tree | std::views::reverse, reference | std::views::reverse));
+  }
+}
+
+TEST(split_join_test, plain)
+{
+  run_split_and_join_against_std_map<splay_tree<int, int>>();
+}
+
+TEST(split_join_test, order_statistics)
+{
+  run_split_and_join_against_std_map<splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>,
+    splay_policy::bottom_up, splay_augmentation::order_statistics>>();
+}
+
+TEST(split_join_test, overlapping_join_throws)
+{
+  splay_tree<int, int> lower{ { 1, 1 }, { 5, 5 } };
+  splay_tree<int, int> upper{ { 3, 3 }, { 7, 7 } };
+
+  EXPECT_THROW(lower.join(upper), std::invalid_argument);
+  EXPECT_EQ(lower.size(), 2);
+  EXPECT_EQ(upper.size(), 2);
+
+  splay_tree<int, int> rest = upper.split(5);
+  EXPECT_EQ(lower.split(4).size(), 1);
+  lower.join(upper);
+  lower.join(rest);
+  EXPECT_TRUE(std::ranges::equal(lower | std::views::keys, std::array{ 1, 3, 7 }));
+  EXPECT_EQ(lower.at(7), 7);
+}
+
+TEST(split_join_test, unequal_allocators_join_throws)
+{
+  using slab_tree = splay_tree<int, int, std::less<int>, slab_allocator<std::pair<const int, int>>>;
+  slab_tree lower = { {1, 1}, {2, 2} };
+  slab_tree upper = { {3, 3} };
+
+  EXPECT_THROW(lower.join(upper), std::invalid_argument);
+  EXPECT_EQ(lower.size(), 2);
+  EXPECT_EQ(upper.size(), 1);
+
+  slab_tree rest = lower.split(2);
+  lower.join(rest);
+  EXPECT_EQ(lower.size(), 2);
+  EXPECT_TRUE(rest.empty());
+}
+
+TEST(split_join_test, equal_allocators_do_not_allocate)
+{
+  counting_allocator<std::pair<const int, int>> allocator;
+  counting_tree lower{ allocator };
+  counting_tree upper{ allocator };
+
+  for (int j = 0; j < 1000; j++)
+  {
+    lower.emplace(j, j);
+    upper.emplace(j + 1000, j + 1000);
+  }
+
+  std::size_t allocations = *allocator.allocations;
+  lower.join(upper);
+  counting_tree middle = lower.split(500);
+  counting_tree top = middle.split(1500);
+  top.join(middle);
+
+  EXPECT_EQ(*allocator.allocations, allocations);
+  EXPECT_EQ(lower.size(), 500);
+  EXPECT_EQ(top.size(), 1500);
+  EXPECT_TRUE(upper.empty());
+  EXPECT_TRUE(middle.empty());
+  EXPECT_TRUE(std::ranges::equal(top | std::views::keys, std::views::iota(500, 2000)));
+}
+
+template<class SplayPolicy>
+void run_range_erase_against_std_map()
+{
+  splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, SplayPolicy, splay_augmentation::order_statistics> tree;
+  std::map<int, int> reference;
+
+  for (int j = 0; j < 3000; j++)
+  {
+    int key = static_cast<int>(random_int(2000));
+    int low = static_cast<int>(random_int(2100)) - 50;
+    int high = low + static_cast<int>(random_int(100));
+
+    switch (random_int(4))
+    {
+    case 0:
+      EXPECT_EQ(tree.erase(low, high), static_cast<std::size_t>(std::distance(reference.lower_bound(low), reference.lower_bound(high))));
+      reference.erase(reference.lower_bound(low), reference.lower_bound(high));
+      break;
+    case 1:
+    {
+      auto it = tree.erase(tree.lower_bound(low), tree.lower_bound(high));
+      auto expected = reference.erase(reference.lower_bound(low), reference.lower_bound(high));
+      EXPECT_EQ(it == tree.end(), expected == reference.end());
+
+      if (expected != reference.end())
+      {
+        EXPECT_EQ(it->first, expected->first);
+      }
+      break;
+    }
+    default:
+      tree.emplace(key, j);
+      reference.emplace(key, j);
+    }
+
+    EXPECT_EQ(tree.size(), reference.size());
+  }
+
+  EXPECT_TRUE(std::ranges::equal(tree, reference));
+  EXPECT_TRUE(std::ranges::equal(tree | std::views::reverse, reference | std::views::reverse));
+
+  for (std::size_t j = 0; j < reference.size(); j += 37)
+  {
+    EXPECT_EQ(tree.nth(j)->first, std::next(reference.begin(), static_cast<std::ptrdiff_t>(j))->first);
+  }
+
+  tree.erase(tree.lower_bound(1000), tree.end());
+  reference.erase(reference.lower_bound(1000), reference.end());
+  EXPECT_TRUE(std::ranges::equal(tree | std::views::reverse, reference | std::views::reverse));
+
+  tree.erase(tree.begin(), tree.end());
+  EXPECT_TRUE(tree.empty());
+  EXPECT_EQ(tree.begin(), tree.end());
+}
+
+TEST(range_erase_test, top_down)
+{
+  run_range_erase_against_std_map<splay_policy::top_down>();
+}
+
+TEST(range_erase_test, bottom_up)
+{
+  run_range_erase_against_std_map<splay_policy::bottom_up>();
+}
+
+template<class SplayPolicy>
+void run_hinted_insertion_against_std_map()
+{
+  using tree_type = splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, SplayPolicy,
+    splay_augmentation::order_statistics>;
+
+  tree_type tree;
+  std::map<int, int> reference;
+  auto hint = tree.cend();
+
+  for (int j = 0; j < 1000; j++)
+  {
+    hint = tree.emplace_hint(hint, j * 2, j);
+    reference.emplace_hint(reference.end(), j * 2, j);
+  }
+
+  for (int j = 0; j < 3000; j++)
+  {
+    int key = static_cast<int>(random_int(2500)) - 250;
+    auto position = random_int(3) == 0 ? tree.find(static_cast<int>(random_int(2000))) : tree.lower_bound(key);
+
+    if (random_int(2) == 0 && position != tree.begin())
+    {
+      --position;
+    }
+
+    auto it = tree.insert(position, std::pair{ key, j });
+    reference.emplace(key, j);
+
+    EXPECT_EQ(it->first, key);
+    EXPECT_EQ(it->second, reference.at(key));
+  }
+
+  EXPECT_EQ(tree.size(), reference.size());
+  EXPECT_TRUE(std::ranges::equal(tree, reference));
+  EXPECT_TRUE(std::ranges::equal(tree | std::views::reverse, reference | std::views::reverse));
+
+  for (std::size_t j = 0; j < reference.size(); j += 41)
+  {
+    EXPECT_EQ(tree.nth(j)->first, std::next(reference.begin(), static_cast<std::ptrdiff_t>(j))->first);
+  }
+}
+
+TEST(hinted_insertion_test, top_down)
+{
+  run_hinted_insertion_against_std_map<splay_policy::top_down>();
+}
+
+TEST(hinted_insertion_test, semi_splay)
+{
+  run_hinted_insertion_against_std_map<splay_policy::semi_splay>();
+}
+
+TEST(hinted_insertion_test, lazy_tree_takes_regular_path)
+{
+  splay_tree<int, long long, std::less<int>, std::allocator<std::pair<const int, long long>>, splay_policy::top_down,
+    splay_augmentation::lazy_aggregate<splay_monoid::sum<long long>, splay_action::add<long long>>> tree{ { 1, 1 }, { 3, 3 } };
+
+  tree.apply_range(0, 10, 5);
+  tree.emplace_hint(tree.cend(), 5, 0);
+  EXPECT_EQ(tree.aggregate(), 14);
+  EXPECT_EQ(tree.at(5), 0);
+}
+
+TEST(finger_search_test, random_walk_against_std_map)
+{
+  splay_tree<int, int> tree;
+  std::map<int, int> reference;
+
+  for (int j = 0; j < 3000; j++)
+  {
+    int key = static_cast<int>(random_int(6000));
+    tree.emplace(key, j);
+    reference.emplace(key, j);
+  }
+
+  auto finger = tree.begin();
+  int key = 3000;
+
+  for (int j = 0; j < 5000; j++)
+  {
+    key += static_cast<int>(random_int(41)) - 20;
+    auto expected = reference.find(key);
+
+    auto it = random_int(2) == 0 ? tree.find_near(finger, key) : tree.find_near(key);
+    EXPECT_EQ(it == tree.end(), expected == reference.end());
+
+    if (it != tree.end())
+    {
+      EXPECT_EQ(it->second, expected->second);
+      finger = it;
+    }
+
+    if (j % 100 == 0)
+    {
+      tree.erase(key);
+      reference.erase(key);
+      finger = tree.begin();
+    }
+  }
+
+  EXPECT_TRUE(std::ranges::equal(tree, reference));
+}
+
+TEST(finger_search_test, finger_is_dropped_with_its_node)
+{
+  splay_tree<int, int> tree{ { 1, 1 }, { 2, 2 }, { 3, 3 }, { 4, 4 } };
+
+  EXPECT_EQ(tree.find_near(3)->second, 3);
+  tree.erase(3);
+  EXPECT_EQ(tree.find_near(3), tree.end());
+  EXPECT_EQ(tree.find_near(4)->second, 4);
+
+  splay_tree<int, int> upper = tree.split(2);
+  EXPECT_EQ(tree.find_near(4), tree.end());
+  EXPECT_EQ(upper.find_near(4)->second, 4);
+
+  tree.swap(upper);
+  EXPECT_EQ(tree.find_near(2)->second, 2);
+  tree.clear();
+  EXPECT_EQ(tree.find_near(2), tree.end());
+}
+
+TEST(batched_lookup_test, find_many_against_std_map)
+{
+  splay_tree<int, int> tree;
+  std::map<int, int> reference;
+
+  for (int j = 0; j < 2000; j++)
+  {
+    int key = static_cast<int>(random_int(4000));
+    tree.emplace(key, j);
+    reference.emplace(key, j);
+  }
+
+  for (int batch = 0; batch < 20; batch++)
+  {
+    std::vector<int> keys(static_cast<std::size_t>(random_int(500)));
+    std::ranges::generate(keys, [] { return static_cast<int>(random_int(4200)) - 100; });
+
+    std::vector<decltype(tree)::iterator> found(keys.size());
+    std::array<bool, 500> contained{};
+    tree.find_many(keys, found);
+    tree.contains_many(keys, std::span{ contained }.first(keys.size()));
+
+    for (std::size_t j = 0; j < keys.size(); j++)
+    {
+      auto expected = reference.find(keys[j]);
+      EXPECT_EQ(found[j] == tree.end(), expected == reference.end());
+      EXPECT_EQ(contained[j], expected != reference.end());
+
+      if (expected != reference.end())
+      {
+        EXPECT_EQ(found[j]->second, expected->second);
+      }
+    }
+
+    std::ranges::sort(keys);
+    tree.find_many(sorted_unique, keys, found);
+    tree.contains_many(sorted_unique, keys, std::span{ contained }.first(keys.size()));
+
+    for (std::size_t j = 0; j < keys.size(); j++)
+    {
+      EXPECT_EQ(found[j] == tree.end(), !reference.contains(keys[j]));
+      EXPECT_EQ(contained[j], reference.contains(keys[j]));
+    }
+  }
+
+  EXPECT_TRUE(std::ranges::equal(tree, reference));
+  EXPECT_TRUE(std::ranges::equal(tree | std::views::reverse, reference | std::views::reverse));
+}
+
+template<std::size_t GroupSize>
+void run_interleaved_lookups_against_std_map()
+{
+  splay_tree<int, int> tree;
+  std::map<int, int> reference;
+
+  for (int j = 0; j < 3000; j++)
+  {
+    int key = static_cast<int>(random_int(6000));
+    tree.emplace(key, j);
+    reference.emplace(key, j);
+  }
+
+  const auto& published = tree;
+  std::vector<int> keys(1001);
+  std::ranges::generate(keys, [] { return static_cast<int>(random_int(6200)) - 100; });
+
+  std::vector<decltype(tree)::const_iterator> found(keys.size());
+  std::array<bool, 1001> contained{};
+  published.find_many<GroupSize>(keys, found);
+  published.contains_many<GroupSize>(keys, contained);
+
+  for (std::size_t j = 0; j < keys.size(); j++)
+  {
+    auto expected = reference.find(keys[j]);
+    EXPECT_EQ(found[j] == published.end(), expected == reference.end());
+    EXPECT_EQ(contained[j], expected != reference.end());
+
+    if (expected != reference.end())
+    {
+      EXPECT_EQ(found[j]->second, expected->second);
+    }
+  }
+
+  splay_tree<int, int> empty;
+  std::as_const(empty).contains_many<GroupSize>(keys, contained);
+  EXPECT_TRUE(std::ranges::none_of(contained, std::identity{}));
+}
+
+TEST(batched_lookup_test, interleaved_single)
+{
+  run_interleaved_lookups_against_std_map<1>();
+}
+
+TEST(batched_lookup_test, interleaved_groups)
+{
+  run_interleaved_lookups_against_std_map<8>();
+  run_interleaved_lookups_against_std_map<13>();
+}
+
+TEST(batched_lookup_test, short_result_buffer_throws)
+{
+  splay_tree<int, int> map = { {1, 1}, {2, 2} };
+  std::array<int, 3> keys{ 1, 2, 3 };
+  std::array<splay_tree<int, int>::iterator, 2> found;
+  std::array<splay_tree<int, int>::const_iterator, 2> const_found;
+  std::array<bool, 2> contained{};
+
+  EXPECT_THROW(map.find_many(keys, found), std::length_error);
+  EXPECT_THROW(map.find_many(sorted_unique, keys, found), std::length_error);
+  EXPECT_THROW(map.contains_many(keys, contained), std::length_error);
+  EXPECT_THROW(map.contains_many(sorted_unique, keys, contained), std::length_error);
+  EXPECT_THROW(std::as_const(map).find_many(keys, const_found), std::length_error);
+  EXPECT_THROW(std::as_const(map).contains_many(keys, contained), std::length_error);
+}
+
+TEST(sharded_test, operations_against_std_map)
+{
+  sharded_splay_tree<int, int> tree{ std::vector{ 500, 250, 750 } };
+  std::map<int, int> reference;
+
+  for (int j = 0; j < 5000; j++)
+  {
+    int key = static_cast<int>(random_int(1000));
+
+    switch (random_int(4))
+    {
+    case 0:
+      EXPECT_EQ(tree.erase(key), reference.erase(key) == 1);
+      break;
+    case 1:
+    {
+      auto found = tree.lower_bound(key);
+      auto expected = reference.lower_bound(key);
+      EXPECT_EQ(found.has_value(), expected != reference.end());
+
+      if (found)
+      {
+        EXPECT_EQ(*found, *expected);
+      }
+      break;
+    }
+    default:
+      EXPECT_EQ(tree.emplace(key, j), reference.emplace(key, j).second);
+    }
+
+    if (j % 1000 == 0)
+    {
+      tree.rebalance();
+    }
+  }
+
+  EXPECT_EQ(tree.size(), reference.size());
+  EXPECT_EQ(tree.find(reference.begin()->first), reference.begin()->second);
+  EXPECT_FALSE(tree.find(-1));
+
+  std::vector<std::pair<int, int>> visited;
+  tree.for_each([&visited](const int& key, int& value) { visited.emplace_back(key, value); });
+  EXPECT_TRUE(std::ranges::equal(visited | std::views::keys, reference | std::views::keys));
+  EXPECT_TRUE(std::ranges::equal(visited | std::views::values, reference | std::views::values));
+
+  tree.rebalance();
+
+  for (std::size_t j = 0; j < tree.shard_count(); j++)
+  {
+    EXPECT_NEAR(static_cast<double>(tree.shard_size(j)), static_cast<double>(reference.size()) / 4, 1.);
+  }
+
+  visited.clear();
+  tree.for_each([&visited](const int& key, int& value) { visited.emplace_back(key, value); });
+  EXPECT_TRUE(std::ranges::equal(visited | std::views::keys, reference | std::views::keys));
+  EXPECT_TRUE(std::ranges::equal(visited | std::views::values, reference | std::views::values));
+}
+
+TEST(sharded_test, concurrent_writers_with_per_shard_pools)
+{
+  sharded_splay_tree<int, int, std::less<int>, slab_allocator<std::pair<const int, int>>> tree{ 8 };
+  std::vector<std::thread> threads;
+  std::atomic<int> lookups_found = 0;
+
+  for (int t = 0; t < 4; t++)
+  {
+    threads.emplace_back([&tree, &lookups_found, t]
+    {
+      for (int j = 0; j < 5000; j++)
+      {
+        int key = j * 4 + t;
+        tree.emplace(key, key);
+
+        if (tree.contains(key))
+        {
+          ++lookups_found;
+        }
+
+        if (j % 2 == 0)
+        {
+          tree.erase(key);
+        }
+      }
+    });
+  }
+
+  threads.emplace_back([&tree]
+  {
+    for (int j = 0; j < 20; j++)
+    {
+      tree.rebalance();
+      std::this_thread::yield();
+    }
+  });
+
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+  EXPECT_EQ(lookups_found, 20000);
+  EXPECT_EQ(tree.size(), 10000);
+
+  int previous = -1;
+  tree.for_each([&previous](const int& key, int& value)
+  {
+    EXPECT_LT(previous, key);
+    EXPECT_EQ(key, value);
+    EXPECT_EQ(key / 4 % 2, 1);
+    previous = key;
+  });
+}
+
+TEST(sharded_test, rebalance_moves_only_elements_that_change_shards)
+{
+  for (bool separate_copies : { false, true })
+  {
+    counting_allocator<std::pair<const int, int>> allocator;
+    allocator.separate_copies = separate_copies;
+    sharded_splay_tree<int, int, std::less<int>, counting_allocator<std::pair<const int, int>>> tree{ std::vector<int>{ 500 },
+      std::less<int>{}, allocator };
+
+    for (int j = 0; j < 2000; j++)
+    {
+      tree.emplace(j, j);
+    }
+
+    std::size_t allocations = *allocator.allocations;
+    tree.rebalance();
+
+    EXPECT_EQ(*allocator.allocations - allocations, separate_copies ? 500 : 0);
+    EXPECT_EQ(tree.shard_size(0), 1000);
+    EXPECT_EQ(tree.shard_size(1), 1000);
+
+    int expected = 0;
+    tree.for_each([&expected](int key, int value)
+    {
+      EXPECT_EQ(key, expected++);
+      EXPECT_EQ(value, key);
+    });
+    EXPECT_EQ(expected, 2000);
+  }
+}
+
+template<class ConcurrentTree>
+void run_concurrent_front_end()
+{
+  ConcurrentTree tree;
+  std::vector<std::thread> threads;
+  std::atomic<int> failures = 0;
+
+  for (int t = 0; t < 8; t++)
+  {
+    threads.emplace_back([&tree, &failures, t]
+    {
+      for (int j = 0; j < 2000; j++)
+      {
+        int key = j * 8 + t;
+        bool ok = tree.emplace(key, key * 2) && !tree.emplace(key, 0) && tree.find(key) == key * 2 && tree.contains(key);
+
+        if (j % 3 == 0)
+        {
+          ok = ok && tree.erase(key) && !tree.contains(key) && !tree.find(key);
+        }
+
+        if (!ok)
+        {
+          ++failures;
+        }
+      }
+    });
+  }
+
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+  EXPECT_EQ(failures, 0);
+  EXPECT_EQ(tree.size(), 8 * (2000 - 667));
+  tree.with_tree([](auto& map)
+  {
+    EXPECT_TRUE(std::ranges::is_sorted(map | std::views::keys));
+    EXPECT_TRUE(std::ranges::all_of(map, [](const auto& pair) { return pair.second == pair.first * 2 && pair.first / 8 % 3 != 0; }));
+  });
+}
+
+TEST(concurrent_front_end_test, flat_combining)
+{
+  run_concurrent_front_end<flat_combining_splay_tree<int, int>>();
+  run_concurrent_front_end<flat_combining_splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>,
+    splay_policy::bottom_up, splay_augmentation::none, 4>>();
+}
+
+TEST(concurrent_front_end_test, locked)
+{
+  run_concurrent_front_end<locked_splay_tree<int, int>>();
+}
+
+struct throwing_on_move
+{
+  int value = 0;
+
+  throwing_on_move(int v) : value{ v }
+  {}
+
+  throwing_on_move(const throwing_on_move&) = default;
+  throwing_on_move& operator=(const throwing_on_move&) = default;
+
+  throwing_on_move(throwing_on_move&& obj) : value{ obj.value }
+  {
+    if (value < 0)
+    {
+      throw std::runtime_error{ "move failed" };
+    }
+  }
+};
+
+TEST(concurrent_front_end_test, failed_request_is_rethrown_to_its_thread)
+{
+  flat_combining_splay_tree<int, throwing_on_move> tree;
+
+  EXPECT_TRUE(tree.emplace(-1, throwing_on_move{ 1 }));
+  EXPECT_THROW(tree.emplace(-2, throwing_on_move{ -1 }), std::runtime_error);
+  EXPECT_TRUE(tree.contains(-1));
+  EXPECT_FALSE(tree.contains(-2));
+
+  std::vector<std::thread> threads;
+  std::atomic<int> failures = 0;
+
+  for (int t = 0; t < 4; t++)
+  {
+    threads.emplace_back([&tree, &failures, t]
+    {
+      for (int j = 0; j < 500; j++)
+      {
+        int key = j * 4 + t;
+
+        if (j % 5 == 0)
+        {
+          try
+          {
+            tree.emplace(key, throwing_on_move{ -key - 1 });
+            ++failures;
+          }
+          catch (const std::runtime_error&)
+          {}
+        }
+        else if (!tree.emplace(key, throwing_on_move{ key }) || tree.find(key)->value != key)
+        {
+          ++failures;
+        }
+      }
+    });
+  }
+
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+  EXPECT_EQ(failures, 0);
+  EXPECT_EQ(tree.size(), 1 + 4 * 400);
+}
+
+TEST(erase_test, erase_last_element_bottom_up)
+{
+  splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, splay_policy::bottom_up> map{ { 1, 1 } };
+
+  EXPECT_TRUE(map.erase(1));
+  EXPECT_EQ(map.size(), 0);
+  EXPECT_EQ(map.begin(), map.end());
+  EXPECT_FALSE(map.contains(1));
+  EXPECT_TRUE(map.emplace(2, 2).second);
+  EXPECT_EQ(map.begin()->first, 2);
+  EXPECT_EQ((--map.end())->first, 2);
+}
+
+TEST(deferred_splay_test, concurrent_readers_and_writer)
+{
+  deferred_splay_tree<int, int> tree{ 64 };
+  std::vector<std::thread> threads;
+  std::atomic<int> failures = 0;
+
+  for (int j = 0; j < 1000; j++)
+  {
+    tree.emplace(j * 2, j);
+  }
+
+  for (int t = 0; t < 6; t++)
+  {
+    threads.emplace_back([&tree, &failures, t]
+    {
+      for (int j = 0; j < 5000; j++)
+      {
+        int key = (j * 7 + t * 13) % 1999;
+        auto found = tree.find(key);
+
+        if (key % 2 == 0 && key < 2000 && found != key / 2)
+        {
+          ++failures;
+        }
+
+        if (key % 2 == 1 && (found || tree.contains(key)))
+        {
+          ++failures;
+        }
+
+        auto next = tree.lower_bound(key);
+
+        if (!next || next->first < key || next->first > key + 1)
+        {
+          ++failures;
+        }
+      }
+    });
+  }
+
+  threads.emplace_back([&tree]
+  {
+    for (int j = 0; j < 500; j++)
+    {
+      tree.emplace(2000 + j * 2, 1000 + j);
+
+      if (j % 50 == 0)
+      {
+        tree.restructure();
+      }
+    }
+  });
+
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+
+  EXPECT_EQ(failures, 0);
+  EXPECT_EQ(tree.size(), 1500);
+  EXPECT_TRUE(tree.erase(0));
+  EXPECT_FALSE(tree.find(0));
+  tree.with_tree([](auto& map)
+  {
+    EXPECT_EQ(map.size(), 1499);
+    EXPECT_TRUE(std::ranges::is_sorted(map | std::views::keys));
+  });
+}
+
+TEST(deferred_splay_test, logs_of_exited_threads_are_reclaimed)
+{
+  deferred_splay_tree<int, int> tree{ 8 };
+  tree.emplace(1, 1);
+
+  for (int t = 0; t < 20; t++)
+  {
+    std::thread{ [&tree] { EXPECT_EQ(tree.find(1), 1); } }.join();
+  }
+
+  EXPECT_EQ(tree.access_log_count(), 20);
+  tree.restructure();
+  EXPECT_EQ(tree.access_log_count(), 0);
+
+  EXPECT_TRUE(tree.contains(1));
+  tree.restructure();
+  EXPECT_EQ(tree.access_log_count(), 1);
+}
+
+TEST(deferred_splay_test, logs_outlive_reader_threads_and_are_per_tree)
+{
+  auto first = std::make_unique<deferred_splay_tree<int, int>>(8);
+  deferred_splay_tree<int, int> second{ 8 };
+  first->emplace(1, 1);
+  second.emplace(2, 2);
+
+  std::thread reader{ [&]
+  {
+    for (int j = 0; j < 100; j++)
+    {
+      EXPECT_EQ(first->find(1), 1);
+      EXPECT_FALSE(first->find(2));
+      EXPECT_EQ(second.find(2), 2);
+    }
+  } };
+  reader.join();
+
+  first->restructure();
+  EXPECT_EQ(first->find(1), 1);
+  first.reset();
+
+  deferred_splay_tree<int, int> third{ 8 };
+  third.emplace(3, 3);
+  EXPECT_EQ(third.find(3), 3);
+  EXPECT_EQ(second.find(2), 2);
+  EXPECT_TRUE(second.emplace(4, 4));
+  EXPECT_EQ(second.size(), 2);
+}
+
+TEST(cow_splay_test, operations_against_std_map)
+{
+  cow_splay_tree<int, int> tree;
+  std::map<int, int> reference;
+
+  for (int j = 0; j < 5000; j++)
+  {
+    int key = static_cast<int>(random_int(1000));
+
+    switch (random_int(5))
+    {
+    case 0:
+      EXPECT_EQ(tree.erase(key), reference.erase(key) == 1);
+      break;
+    case 1:
+      EXPECT_EQ(tree.contains(key), reference.contains(key));
+      EXPECT_EQ(std::as_const(tree).contains(key), reference.contains(key));
+      break;
+    case 2:
+      EXPECT_EQ(tree.insert_or_assign(key, j), reference.insert_or_assign(key, j).second);
+      break;
+    default:
+    {
+      auto [it, inserted] = tree.emplace(key, j);
+      EXPECT_EQ(inserted, reference.emplace(key, j).second);
+      EXPECT_EQ(it->second, reference.at(key));
+    }
+    }
+  }
+
+  EXPECT_EQ(tree.size(), reference.size());
+  EXPECT_TRUE(std::ranges::equal(tree, reference));
+  EXPECT_EQ(std::as_const(tree).lower_bound(500)->first, reference.lower_bound(500)->first);
+  EXPECT_EQ(tree.find(reference.begin()->first)->second, reference.begin()->second);
+  EXPECT_EQ(tree.find(-1), tree.end());
+}
+
+TEST(cow_splay_test, snapshots_are_unaffected_by_later_writes)
+{
+  cow_splay_tree<int, std::string> tree;
+  std::map<int, std::string> reference;
+
+  for (int j = 0; j < 1000; j++)
+  {
+    tree.emplace(j, std::to_string(j));
+    reference.emplace(j, std::to_string(j));
+  }
+
+  std::vector<std::pair<cow_splay_tree<int, std::string>, std::map<int, std::string>>> snapshots;
+
+  for (int round = 0; round < 10; round++)
+  {
+    snapshots.emplace_back(tree.snapshot(), reference);
+
+    for (int j = 0; j < 300; j++)
+    {
+      int key = static_cast<int>(random_int(1200));
+
+      if (random_int(2) == 0)
+      {
+        tree.erase(key);
+        reference.erase(key);
+      }
+      else
+      {
+        tree.insert_or_assign(key, std::to_string(round));
+        reference.insert_or_assign(key, std::to_string(round));
+      }
+
+      tree.find(static_cast<int>(random_int(1200)));
+    }
+  }
+
+  for (auto& [snapshot, expected] : snapshots)
+  {
+    EXPECT_EQ(snapshot.size(), expected.size());
+    EXPECT_TRUE(std::ranges::equal(snapshot, expected));
+  }
+
+  snapshots.erase(snapshots.begin(), snapshots.begin() + 5);
+  EXPECT_TRUE(std::ranges::equal(tree, reference));
+
+  auto copy = snapshots.back().first;
+  copy.clear();
+  EXPECT_TRUE(std::ranges::equal(snapshots.back().first, snapshots.back().second));
+}
+
+TEST(cow_splay_test, reader_iterates_snapshot_during_writes)
+{
+  cow_splay_tree<int, int> tree;
+
+  for (int j = 0; j < 100000; j++)
+  {
+    tree.emplace(j, j);
+  }
+
+  std::atomic<bool> consistent = true;
+  std::thread reader{ [&consistent, snapshot = tree.snapshot()]
+  {
+    int expected = 0;
+
+    for (const auto& [key, value] : snapshot)
+    {
+      if (key != expected || value != expected)
+      {
+        consistent = false;
+      }
+
+      ++expected;
+    }
+
+    consistent = consistent && expected == 100000;
+  } };
+
+  for (int j = 0; j < 20000; j++)
+  {
+    tree.erase(static_cast<int>(random_int(100000)));
+    tree.insert_or_assign(static_cast<int>(random_int(100000)), -1);
+  }
+
+  reader.join();
+  EXPECT_TRUE(consistent);
+}
+
+TEST(stats_test, disabled_stats_add_no_state)
+{
+  static_assert(std::is_empty_v<splay_stats::none>);
+  static_assert(sizeof(splay_tree<int, int>) == sizeof(splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>,
+    splay_policy::top_down, splay_augmentation::none, splay_stats::none>));
+  static_assert(sizeof(splay_tree<int, int>) < sizeof(splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>,
+    splay_policy::top_down, splay_augmentation::none, splay_stats::counters<>>));
+}
+
+TEST(stats_test, sequential_inserts_leave_a_spine)
+{
+  using splay_stats::rotation;
+  splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, splay_policy::bottom_up, splay_augmentation::none,
+    splay_stats::counters<>> tree;
+
+  for (int j = 0; j < 32; j++)
+  {
+    tree.emplace(j, j);
+  }
+
+  ASSERT_EQ(tree.stats().allocations, 32);
+
+  tree.reset_stats();
+  ASSERT_EQ(tree.stats().allocations, 0);
+  ASSERT_EQ(tree.stats().comparisons, 0);
+
+  tree.find(0);
+  ASSERT_EQ(tree.stats().depth_histogram[32], 1);
+  ASSERT_EQ(tree.stats().rotation_count(rotation::zig_zig), 15);
+  ASSERT_EQ(tree.stats().rotation_count(rotation::zig), 1);
+  ASSERT_EQ(tree.stats().comparisons, 33);
+  ASSERT_EQ(tree.stats().skipped_splays, 0);
+}
+
+TEST(stats_test, counts_top_down_steps_and_skipped_splays)
+{
+  using splay_stats::rotation;
+  splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, splay_policy::top_down, splay_augmentation::none,
+    splay_stats::counters<8>> top_down;
+
+  for (int j = 0; j < 32; j++)
+  {
+    top_down.emplace(j, j);
+  }
+
+  top_down.reset_stats();
+  top_down.find(0);
+  ASSERT_EQ(top_down.stats().depth_histogram[7], 1);
+  ASSERT_GT(top_down.stats().rotation_count(rotation::zig_zig), 0);
+  ASSERT_EQ(top_down.stats().rotation_count(rotation::zag_zag), 0);
+
+  splay_tree<int, int, std::less<int>, std::allocator<std::pair<const int, int>>, splay_policy::splay_on_hit<>, splay_augmentation::none,
+    splay_stats::counters<>> on_hit{ { 1, 1 }, { 3, 3 } };
+  on_hit.find(2);
+  on_hit.find(3);
+  ASSERT_EQ(on_hit.stats().skipped_splays, 1);
+}
+
+TEST(compact_splay_test, operations_against_std_map)
+{
+  compact_splay_tree<int, int> tree;
+  std::map<int, int> reference;
+
+  for (int j = 0; j < 5000; j++)
+  {
+    int key = static_cast<int>(random_int(1000));
+
+    switch (random_int(5))
+    {
+    case 0:
+      EXPECT_EQ(tree.erase(key), reference.erase(key) == 1);
+      break;
+    case 1:
+      EXPECT_EQ(tree.contains(key), reference.contains(key));
+      EXPECT_EQ(std::as_const(tree).contains(key), reference.contains(key));
+      break;
+    case 2:
+    {
+      auto it = tree.lower_bound(key);
+      auto expected = reference.lower_bound(key);
+      EXPECT_EQ(it == tree.end(), expected == reference.end());
+
+      if (expected != reference.end())
+      {
+        EXPECT_EQ(it->first, expected->first);
+      }
+      break;
+    }
+    default:
+    {
+      auto [it, inserted] = tree.emplace(key, j);
+      EXPECT_EQ(inserted, reference.emplace(key, j).second);
+      EXPECT_EQ(it->second, reference.at(key));
+    }
+    }
+  }
+
+  EXPECT_EQ(tree.size(), reference.size());
+  EXPECT_TRUE(std::ranges::equal(tree | std::views::keys, reference | std::views::keys));
+  EXPECT_TRUE(std::ranges::equal(tree | std::views::values, reference | std::views::values));
+  EXPECT_TRUE(std::ranges::equal(tree | std::views::reverse | std::views::keys, reference | std::views::reverse | std::views::keys));
+  EXPECT_EQ(std::as_const(tree).upper_bound(500)->first, reference.upper_bound(500)->first);
+  EXPECT_EQ(tree.find(-1), tree.end());
+  EXPECT_THROW(tree.at(-1), std::out_of_range);
+
+  compact_splay_tree<int, int> copy = tree;
+  tree.clear();
+  EXPECT_TRUE(tree.empty());
+  EXPECT_TRUE(std::ranges::equal(copy | std::views::keys, reference | std::views::keys));
+}
+
+TEST(compact_splay_test, iterators_survive_growth_and_slots_are_reused)
+{
+  compact_splay_tree<int, std::string> tree;
+  auto [first, inserted] = tree.emplace(0, "zero");
+
+  for (int j = 1; j < 1000; j++)
+  {
+    tree.emplace(j, std::to_string(j));
+  }
+
+  EXPECT_EQ(first->second, "zero");
+
+  for (auto it = std::next(tree.begin()); it != tree.end();)
+  {
+    it = it->first % 2 == 0 ? tree.erase(it) : std::next(it);
+  }
+
+  EXPECT_EQ(tree.size(), 501);
+  EXPECT_EQ(first->second, "zero");
+
+  std::size_t capacity = tree.capacity();
+
+  for (int j = 1000; j < 1499; j++)
+  {
+    tree[j] = std::to_string(j);
+  }
+
+  EXPECT_EQ(tree.capacity(), capacity);
+  EXPECT_EQ(tree.size(), 1000);
+  EXPECT_EQ(tree.at(1498), "1498");
+  EXPECT_EQ(tree.begin(), first);
+  EXPECT_EQ((--tree.end())->first, 1498);
+}
+
+TEST(compact_splay_test, emplace_from_own_element_at_full_capacity)
+{
+  compact_splay_tree<int, std::string> tree;
+
+  for (int j = 0; tree.size() == 0 || tree.size() < tree.capacity(); j++)
+  {
+    tree.emplace(j, "a string too long for the small buffer " + std::to_string(j));
+  }
+
+  std::size_t capacity = tree.capacity();
+  auto [it, inserted] = tree.emplace(100, tree.find(3)->second);
+
+  EXPECT_TRUE(inserted);
+  EXPECT_GT(tree.capacity(), capacity);
+  EXPECT_EQ(it->second, "a string too long for the small buffer 3");
+  EXPECT_EQ(tree.at(3), it->second);
+}
+
+TEST(compact_splay_test, iterators_follow_move_and_swap)
+{
+  compact_splay_tree<int, int> tree{ { 1, 1 }, { 2, 2 }, { 3, 3 } };
+  auto it = tree.find(2);
+
+  compact_splay_tree<int, int> moved = std::move(tree);
+  EXPECT_TRUE(tree.empty());
+  EXPECT_EQ(it, moved.find(2));
+  EXPECT_EQ(std::next(it), moved.find(3));
+  EXPECT_EQ(std::prev(moved.end())->first, 3);
+
+  compact_splay_tree<int, int> other{ { 10, 10 } };
+  auto other_it = other.begin();
+  moved.swap(other);
+  EXPECT_EQ(it->second, 2);
+  EXPECT_EQ(std::prev(it), other.begin());
+  EXPECT_EQ(other_it, moved.begin());
+  EXPECT_EQ(++other_it, moved.end());
+
+  tree = std::move(other);
+  EXPECT_EQ(++it, tree.find(3));
+}
+
+TEST(compact_splay_test, hinted_insertion_and_merge)
+{
+  compact_splay_tree<int, int> tree;
+  std::map<int, int> reference;
+  auto hint = tree.cend();
+
+  for (int j = 0; j < 1000; j++)
+  {
+    hint = tree.emplace_hint(hint, j * 2, j);
+    reference.emplace_hint(reference.end(), j * 2, j);
+  }
+
+  for (int j = 0; j < 1000; j++)
+  {
+    int key = static_cast<int>(random_int(2100));
+    auto it = tree.insert(tree.lower_bound(static_cast<int>(random_int(2100))), std::pair{ key, j });
+    EXPECT_EQ(it->first, key);
+    reference.emplace(key, j);
+  }
+
+  EXPECT_TRUE(std::ranges::equal(tree, reference));
+  EXPECT_TRUE(std::ranges::equal(tree | std::views::reverse, reference | std::views::reverse));
+
+  compact_splay_tree<int, int> other{ { -1, 0 }, { 0, 5 }, { 5000, 0 } };
+  tree.merge(other);
+  reference.merge(std::map<int, int>{ { -1, 0 }, { 5000, 0 } });
+  EXPECT_TRUE(std::ranges::equal(tree, reference));
+  EXPECT_EQ(other.size(), 1);
+  EXPECT_EQ(other.at(0), 5);
+
+  tree.merge(compact_splay_tree<int, int>{ { 6000, 0 } });
+  EXPECT_TRUE(tree.contains(6000));
+  EXPECT_EQ(tree.get_allocator(), decltype(tree)::allocator_type{});
+}